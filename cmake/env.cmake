@@ -9,13 +9,15 @@ set(EXECUTABLE_OUTPUT_PATH ${PROJECT_BINARY_DIR}/bin)
 set(CMAKE_CXX_FLAGS "--std=c++14 -g")
 
 # Packages
-FIND_PACKAGE(OpenGL REQUIRED)
-INCLUDE_DIRECTORIES(${OPENGL_INCLUDE_DIRS})
-LINK_DIRECTORIES(${OPENGL_LIBRARY_DIRS})
-ADD_DEFINITIONS(${OPENGL_DEFINITIONS})
+IF (NOT HEADLESS)
+	FIND_PACKAGE(OpenGL REQUIRED)
+	INCLUDE_DIRECTORIES(${OPENGL_INCLUDE_DIRS})
+	LINK_DIRECTORIES(${OPENGL_LIBRARY_DIRS})
+	ADD_DEFINITIONS(${OPENGL_DEFINITIONS})
 
-MESSAGE(STATUS "OpenGL: ${OPENGL_LIBRARIES}")
-LIST(APPEND stdgl_libraries ${OPENGL_gl_LIBRARY})
+	MESSAGE(STATUS "OpenGL: ${OPENGL_LIBRARIES}")
+	LIST(APPEND stdgl_libraries ${OPENGL_gl_LIBRARY})
+ENDIF ()
 
 if (APPLE)
 	FIND_LIBRARY(COCOA_LIBRARY Cocoa REQUIRED)
@@ -1,225 +1,166 @@
 #include "Terrain.h"
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 #include <iostream>
 #include "glm/gtx/string_cast.hpp"
+#include "noise.h"
+#include "profiler.h"
 
-constexpr double pi = 3.14159265358979323846264338;
+Chunk::Chunk(const glm::ivec2& location, int extent, uint64_t worldSeed)
+{
+    constexpr uint64_t kTextureSalt = 0x7e57u;
+    this->tex_seed =
+            (uint32_t)latticeHash(worldSeed, kTextureSalt, location.x,
+                                  location.y);
+    this->world_seed = worldSeed;
+    this->loc = location;
+    this->extent = extent;
+}
 
-// Generate a point on a circle
-glm::vec2 circleSample(float theta)
+std::vector<float> Chunk::genPerlinNoise() const
 {
-    return glm::vec2(cos(theta), sin(theta));
+    std::vector<float> outputs(extent * extent);
+    terrainNoise(this->world_seed).tile(this->loc, extent, outputs.data());
+    return outputs;
 }
 
-Chunk::Chunk(const glm::ivec2& location, int extent, std::mt19937& gen,
-             Terrain* T)
+TerrainNoise terrainNoise(uint64_t worldSeed)
 {
-    //std::cout << "Location is " << glm::to_string(location) << std::endl;
-    this->tex_seed = gen();
-    this->loc = location;
-    this->extent = extent;
+    return TerrainNoise(worldSeed, 2.0f, 2.0f, 0.25f, 1.0f / 1.5f);
+}
 
-    std::uniform_real_distribution<> dis(0.0,pi);
+std::vector<float> Chunk::texSeedMap() const
+{
+    return columnSeeds(this->tex_seed, extent * extent);
+}
 
-    for(int i = 0; i < 4; i++){
-        O1grad[i] = circleSample(dis(gen));
-    }
-    for(int i = 0; i < 9; i++){
-        O2grad[i] = circleSample(dis(gen));
-    }
+Chunk Terrain::getChunk(glm::ivec2 chunkCoords) const
+{
+    return Chunk(chunkCoords, this->chunkExtent, this->seed);
+}
+
+namespace {
+// Filler cubes needed under a cell of height h whose lowest neighbor has
+// height low: one per whole unit of drop
+int fillerDepth(float h, float low)
+{
+    return std::max(0, (int)floor(h - low - 0.001));
+}
 
-    if(location == glm::ivec2(0,0)){return;}
-
-    // Rule: Chunk closest to chunk (0,0) takes precedence
-    if(location.x == 0){ ((void)0);}
-    else if(location.x > 0){ // Replace left edge
-        const Chunk& C = T->getChunk(location + glm::ivec2(-1,0));
-        O1grad[0] = C.O1grad[1];
-        O1grad[2] = C.O1grad[3];
-        O2grad[0] = C.O2grad[2];
-        O2grad[3] = C.O2grad[5];
-        O2grad[6] = C.O2grad[8];
+// Lowest of the in-bounds neighbors of cell (x, z) in a row-major grid,
+// or the cell itself if it has none lower
+float lowestNeighbor(const std::vector<glm::vec3>& cells, int x, int z,
+                     int rowLength, int rows)
+{
+    int i = x + rowLength * z;
+    float low = cells[i].y;
+    if (x > 0) {
+        low = std::min(low, cells[i - 1].y);
     }
-    else{ // Replace right edge
-        const Chunk& C = T->getChunk(location + glm::ivec2(1,0));
-        O1grad[1] = C.O1grad[0];
-        O1grad[3] = C.O1grad[2];
-        O2grad[2] = C.O2grad[0];
-        O2grad[5] = C.O2grad[3];
-        O2grad[8] = C.O2grad[6];
+    if (x + 1 < rowLength) {
+        low = std::min(low, cells[i + 1].y);
     }
-    if(location.y == 0){ ((void)0); }
-    else if(location.y > 0){ // Replace Bot edge
-        const Chunk& C = T->getChunk(location + glm::ivec2(0,-1));
-        O1grad[0] = C.O1grad[2];
-        O1grad[1] = C.O1grad[3];
-        O2grad[0] = C.O2grad[6];
-        O2grad[1] = C.O2grad[7];
-        O2grad[2] = C.O2grad[8];
+    if (z > 0) {
+        low = std::min(low, cells[i - rowLength].y);
     }
-    else{
-        const Chunk& C = T->getChunk(location + glm::ivec2(0,1));
-        O1grad[2] = C.O1grad[0];
-        O1grad[3] = C.O1grad[1];
-        O2grad[6] = C.O2grad[0];
-        O2grad[7] = C.O2grad[1];
-        O2grad[8] = C.O2grad[2];
+    if (z + 1 < rows) {
+        low = std::min(low, cells[i + rowLength].y);
     }
+    return low;
+}
 }
 
-constexpr float perlinFade(float t)
+void fixNeighborGaps(std::vector<glm::vec3>& surfaceMap, int chunkExtent)
 {
-    return 6 * t * t * t * t * t - 15 * t * t * t * t + 10 * t * t * t;
+    ScopedTimer timer(kZoneSeams);
+    int rows = (int)surfaceMap.size() / chunkExtent;
+
+    // Count first so the map grows exactly once
+    size_t fillers = 0;
+    for (int z = 0; z < rows; z++) {
+        for (int x = 0; x < chunkExtent; x++) {
+            float low = lowestNeighbor(surfaceMap, x, z, chunkExtent, rows);
+            fillers += fillerDepth(surfaceMap[x + chunkExtent * z].y, low);
+        }
+    }
+    surfaceMap.reserve(surfaceMap.size() + fillers);
+
+    for (int z = 0; z < rows; z++) {
+        for (int x = 0; x < chunkExtent; x++) {
+            glm::vec3 top = surfaceMap[x + chunkExtent * z];
+            float low = lowestNeighbor(surfaceMap, x, z, chunkExtent, rows);
+            int depth = fillerDepth(top.y, low);
+            for (int k = 1; k <= depth; k++) {
+                surfaceMap.emplace_back(top.x, top.y - (float)k, top.z);
+            }
+        }
+    }
 }
 
-/* coords: coordinates to take noise at. Scaled to be on a 0-1 square
-   grads: gradients at corners. grad[0] is at (0,0), grad[1] is at (1,0),
-                                grad[2] is at (0,1), grad[3] is at (1,1) */
-float perlinNoiseSquare(const glm::vec2& coords, const glm::vec2* grad)
+void Terrain::setCacheBudget(size_t bytesPerCache)
 {
-    glm::vec2 from0 = coords - glm::vec2(0, 0);
-    glm::vec2 from1 = coords - glm::vec2(1, 0);
-    glm::vec2 from2 = coords - glm::vec2(0, 1);
-    glm::vec2 from3 = coords - glm::vec2(1, 1);
-
-    float inf0 = glm::dot(grad[0], from0);
-    float inf1 = glm::dot(grad[1], from1);
-    float inf2 = glm::dot(grad[2], from2);
-    float inf3 = glm::dot(grad[3], from3);
-
-    float top = glm::mix(inf2, inf3, perlinFade(coords[0]));
-    float bot = glm::mix(inf0, inf1, perlinFade(coords[0]));
-    float mid = glm::mix(bot, top, perlinFade(coords[1]));
-
-    mid = (mid / (sqrt(2) / 2) + 1) / 2;
-    return mid;
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    this->noiseCache.setBudget(bytesPerCache);
+    this->surfaceCache.setBudget(bytesPerCache);
 }
 
-
-
-std::vector<float> Chunk::genPerlinNoise() const
+CacheStats Terrain::noiseCacheStats() const
 {
-    std::vector<float> outputs;
-    outputs.resize(extent * extent);
-
-    // TODO: rewrite to clamp to edges
-
-    // Generate 16 equispaced points on a (0,2) square.
-    glm::vec2 cellGrads1[4]; // Octave 1 noise
-    float delta = 2 / float(extent - 1);
-    for (int i = 0; i < extent; i++) {
-        for (int j = 0; j < extent; j++) {
-            // Set grads
-            if (i < extent / 2 && j < extent / 2) {
-                if (j < extent / 2) {
-                    // lower-left quadrant
-                    cellGrads1[0] = O2grad[0];
-                    cellGrads1[1] = O2grad[1];
-                    cellGrads1[2] = O2grad[3];
-                    cellGrads1[3] = O2grad[4];
-                } else {
-                    // upper-left quadrant
-                    cellGrads1[0] = O2grad[3];
-                    cellGrads1[1] = O2grad[4];
-                    cellGrads1[2] = O2grad[6];
-                    cellGrads1[3] = O2grad[7];
-                }
-            } else {
-                if (j < extent / 2) {
-                    // lower-right quadrant
-                    cellGrads1[0] = O2grad[1];
-                    cellGrads1[1] = O2grad[2];
-                    cellGrads1[2] = O2grad[4];
-                    cellGrads1[3] = O2grad[5];
-
-                } else {
-                    // upper-right quadrant
-                    cellGrads1[0] = O2grad[4];
-                    cellGrads1[1] = O2grad[5];
-                    cellGrads1[2] = O2grad[7];
-                    cellGrads1[3] = O2grad[8];
-                }
-            }
-
-            // Set coordinates
-            float cellX = i * delta - (int)(i * delta);
-            float cellY = j * delta - (int)(j * delta);
-            glm::vec2 coordsLoOctave(cellX, cellY);
-            glm::vec2 coordsHiOctave(i * delta / 2.0, j * delta / 2.0);
-
-            int index = i + j * extent;
-
-            outputs[index] =
-                    0.25 * perlinNoiseSquare(coordsHiOctave, cellGrads1);
-            outputs[index] += perlinNoiseSquare(coordsLoOctave, &O1grad[0]);
-            outputs[index] /= 1.5;
-        }
-    }
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    return this->noiseCache.getStats();
+}
 
-    return outputs;
+CacheStats Terrain::surfaceCacheStats() const
+{
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    return this->surfaceCache.getStats();
 }
 
-std::vector<float> Chunk::texSeedMap() const
+bool Terrain::hasSurface(glm::ivec2 chunkCoords) const
 {
-    std::mt19937 gen(this->tex_seed);
-    std::uniform_real_distribution<double> dis(0.0, 1.0);
-    std::vector<float> output;
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    return this->surfaceCache.contains(chunkCoords);
+}
 
-    for (int i = 0; i < extent * extent; i++) {
-        output.push_back(dis(gen));
-    }
-    return output;
+void Terrain::prefetchSurface(glm::ivec2 chunkCoords)
+{
+    this->blendedNoise(chunkCoords);
 }
 
-const Chunk& Terrain::getChunk(glm::ivec2 chunkCoords)
+std::vector<float> Terrain::chunkNoise(glm::ivec2 chunkCoords)
 {
-    auto chunk = this->chunkMap.find(chunkCoords);
-    if (chunk == this->chunkMap.end()) {
-        Chunk c = Chunk(chunkCoords, this->chunkExtent, this->gen, this);
-        auto status = this->chunkMap.insert({chunkCoords, c});
-        if (!status.second) {
-            std::cerr << "Could not insert chunk into chunkMap" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+        const std::vector<float>* cached = this->noiseCache.find(chunkCoords);
+        if (cached) {
+            return *cached;
         }
-        return status.first->second;
-    } else {
-        return chunk->second;
     }
+    std::vector<float> noise = this->getChunk(chunkCoords).genPerlinNoise();
+    size_t bytes = noise.size() * sizeof(float);
+
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    this->noiseCache.insert(chunkCoords, noise, bytes);
+    return noise;
 }
 
-void fixNeighborGaps(std::vector<glm::vec3>& surfaceMap, int chunkExtent)
+std::vector<float> Terrain::blendedNoise(glm::ivec2 chunkCoords)
 {
-    for (int i = (int)surfaceMap.size() - 1; i >= 0; i--) {
-        std::vector<int> neighbors = {i + 1, i - 1, i + chunkExtent,
-                                      i - chunkExtent};
-
-        for (int j : neighbors) {
-            if (j < chunkExtent * chunkExtent && j > 0) {
-                // This neighbor is in-bounds. How bad is the gap?
-                float gapSize =
-                        floor(surfaceMap[i].y - surfaceMap[j].y - 0.001);
-                if (gapSize <= 0.0)
-                    continue;
-                // For each unit of gapSize, add a patch
-                for (int k = 1; k <= gapSize; k++) {
-                    surfaceMap.push_back(glm::vec3(surfaceMap[i].x,
-                                                   surfaceMap[i].y - (float)k,
-                                                   surfaceMap[i].z));
-                }
-            }
+    {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+        const std::vector<float>* cached =
+                this->surfaceCache.find(chunkCoords);
+        if (cached) {
+            return *cached;
         }
     }
-}
 
-std::vector<glm::vec3> Terrain::chunkSurface(glm::ivec2 chunkCoords,
-                                             glm::vec2 heights)
-{
-    const Chunk& C = this->getChunk(chunkCoords);
-    std::vector<float> noise = C.genPerlinNoise();
+    std::vector<float> noise = this->chunkNoise(chunkCoords);
 
     // Interpolate edge squares with neighbor's edge square to eliminate seaming
     for (int z = 0; z < 4; z++) {
-        std::vector<float> neighborNoise;
+        glm::ivec2 neighbor;
         int start, Nstart;
         int stride, Nstride;
 
@@ -231,24 +172,21 @@ std::vector<glm::vec3> Terrain::chunkSurface(glm::ivec2 chunkCoords,
 
                 stride = 1;
                 Nstride = 1;
-                neighborNoise = this->getChunk(chunkCoords + glm::ivec2(0, -1))
-                                        .genPerlinNoise();
+                neighbor = glm::ivec2(0, -1);
                 break;
             case 1: // Left edge
                 start = 0;
                 Nstart = this->chunkExtent - 1;
                 stride = this->chunkExtent;
                 Nstride = this->chunkExtent;
-                neighborNoise = this->getChunk(chunkCoords + glm::ivec2(-1, 0))
-                                        .genPerlinNoise();
+                neighbor = glm::ivec2(-1, 0);
                 break;
             case 2: // Right Edge
                 start = this->chunkExtent - 1;
                 Nstart = 0;
                 stride = this->chunkExtent;
                 Nstride = this->chunkExtent;
-                neighborNoise = this->getChunk(chunkCoords + glm::ivec2(1, 0))
-                                        .genPerlinNoise();
+                neighbor = glm::ivec2(1, 0);
                 break;
             case 3: // Top edge
                 start = this->chunkExtent * this->chunkExtent -
@@ -256,20 +194,30 @@ std::vector<glm::vec3> Terrain::chunkSurface(glm::ivec2 chunkCoords,
                 stride = 1;
                 Nstart = 0;
                 Nstride = 1;
-                neighborNoise = this->getChunk(chunkCoords + glm::ivec2(0, 1))
-                                        .genPerlinNoise();
+                neighbor = glm::ivec2(0, 1);
                 break;
         }
 
-        //std::cout << "CASE " << z << std::endl;
+        std::vector<float> neighborNoise =
+                this->chunkNoise(chunkCoords + neighbor);
         for (int i = 0; i < this->chunkExtent; i++) {
-            //std::cout << neighborNoise.size() << ", " << i*Nstride+Nstart << std::endl;
             noise[i * stride + start] =
                     glm::mix(noise[i * stride + start],
                              neighborNoise[i * Nstride + Nstart], 0.4);
         }
     }
 
+    size_t bytes = noise.size() * sizeof(float);
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    this->surfaceCache.insert(chunkCoords, noise, bytes);
+    return noise;
+}
+
+std::vector<glm::vec3> Terrain::chunkSurface(glm::ivec2 chunkCoords,
+                                             glm::vec2 heights)
+{
+    std::vector<float> noise = this->blendedNoise(chunkCoords);
+
     // Generate surface Map
     std::vector<glm::vec3> surfaceMap;
     surfaceMap.resize(this->chunkExtent * this->chunkExtent);
@@ -278,9 +226,9 @@ std::vector<glm::vec3> Terrain::chunkSurface(glm::ivec2 chunkCoords,
     for (int i = 0; i < this->chunkExtent; i++) {
         for (int j = 0; j < this->chunkExtent; j++) {
             int index = i + this->chunkExtent * j;
-            glm::vec3 coords((float)C.loc.x + (float)i,
+            glm::vec3 coords((float)chunkCoords.x + (float)i,
                              round(noise[index] * delta + heights.x),
-                             (float)C.loc.y + (float)j);
+                             (float)chunkCoords.y + (float)j);
             surfaceMap[index] = coords;
         }
     }
@@ -295,19 +243,51 @@ glm::ivec2 Terrain::getChunkCoords(glm::vec3 coords) const
                       (int)coords.z / this->chunkExtent);
 }
 
-std::vector<glm::vec3> Terrain::getOffsetsForRender(glm::vec3 camCoords,
-                                                    glm::vec2 heights)
+// A world point that getChunkCoords() maps back to chunkCoords. Chunk
+// coordinates truncate toward zero, so negative chunks extend the other way.
+glm::vec3 Terrain::getChunkCenter(glm::ivec2 chunkCoords) const
 {
-    glm::ivec2 center = this->getChunkCoords(camCoords);
+    float half = this->chunkExtent / 2.0f;
+    return glm::vec3(chunkCoords.x * this->chunkExtent +
+                             (chunkCoords.x < 0 ? -half : half),
+                     0.0f,
+                     chunkCoords.y * this->chunkExtent +
+                             (chunkCoords.y < 0 ? -half : half));
+}
 
+constexpr float Terrain::kFillerSeed;
+const glm::vec2 Terrain::kRenderHeights(-15.0, 0.0);
+
+void Terrain::setViewRadius(int radius)
+{
+    this->viewRadius = std::max(radius, 0);
+}
+
+void Terrain::setRegionStore(std::shared_ptr<RegionStore> store)
+{
+    this->regions = store;
+}
+
+bool Terrain::loadColumns(glm::ivec2 chunkCoords, glm::vec2 heights,
+                          ChunkColumns& columns)
+{
+    return this->regions && this->regions->getHeights() == heights &&
+           this->regions->load(chunkCoords, columns);
+}
+
+std::vector<glm::vec3> Terrain::viewSurface(glm::ivec2 center,
+                                            glm::vec2 heights)
+{
     // Get surfacemap from each chunk
     std::vector<glm::vec3> offsets;
-    int offsetSize = 5 * this->chunkExtent;
+    int side = 2 * this->viewRadius + 1;
+    int offsetSize = this->viewEdge();
     offsets.resize(offsetSize * offsetSize);
 
-    for (int i = 0; i < 5; i++) {
-        for (int j = 0; j < 5; j++) {
-            glm::ivec2 c(center + glm::ivec2(i - 2, j - 2)); // Chunk's indices
+    for (int i = 0; i < side; i++) {
+        for (int j = 0; j < side; j++) {
+            glm::ivec2 c(center + glm::ivec2(i - this->viewRadius,
+                                             j - this->viewRadius));
             std::vector<glm::vec3> cOffsets = this->chunkSurface(c, heights);
             for (auto& offset : cOffsets) {
                 offset += glm::vec3(c.x, 0.0, c.y) *
@@ -325,29 +305,242 @@ std::vector<glm::vec3> Terrain::getOffsetsForRender(glm::vec3 camCoords,
             }
         }
     }
+    return offsets;
+}
 
-    // Fill seams
-    fixNeighborGaps(offsets, offsetSize);
+ChunkColumns Terrain::getChunkColumns(glm::ivec2 chunkCoords,
+                                      glm::vec2 heights)
+{
+    int n = this->chunkExtent;
+    ChunkColumns columns;
+    if (this->loadColumns(chunkCoords, heights, columns)) {
+        return columns;
+    }
+    columns.origin = chunkCoords * n;
+    columns.extent = n;
+    columns.texSeed = this->getChunk(chunkCoords).getTexSeed();
+    columns.top.resize(n * n);
+    columns.depth.resize(n * n);
+
+    // Surface heights with a one-cube border borrowed from the neighbors
+    int edge = n + 2;
+    std::vector<float> height = this->surfaceHeights(chunkCoords, heights, 1);
+
+    // Filler depth per column, as in fixNeighborGaps(). Heights stay within
+    // the render heights, far less than 255 blocks apart.
+    ScopedTimer timer(kZoneSeams);
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            int h = (i + 1) + edge * (j + 1);
+            float low = std::min(std::min(height[h - 1], height[h + 1]),
+                                 std::min(height[h - edge], height[h + edge]));
+            columns.top[i + n * j] = (int16_t)height[h];
+            columns.depth[i + n * j] =
+                    (uint8_t)std::min(fillerDepth(height[h], low), 255);
+        }
+    }
+    return columns;
+}
 
-    // Sinkhole other cubes
-    while (offsets.size() < 32000) {
-        offsets.emplace_back(0.0f, -1000.0f, 0.0f);
+std::vector<float> Terrain::surfaceHeights(glm::ivec2 chunkCoords,
+                                           glm::vec2 heights, int apron)
+{
+    int n = this->chunkExtent;
+    apron = std::min(std::max(apron, 0), n);
+    int edge = n + 2 * apron;
+    std::vector<float> height(edge * edge);
+
+    for (int cj = -1; cj <= 1; cj++) {
+        for (int ci = -1; ci <= 1; ci++) {
+            if ((ci != 0 || cj != 0) && apron == 0) {
+                continue;
+            }
+            // Columns of this neighbor that fall inside the apron
+            int i0 = ci < 0 ? n - apron : 0;
+            int i1 = ci > 0 ? apron : n;
+            int j0 = cj < 0 ? n - apron : 0;
+            int j1 = cj > 0 ? apron : n;
+            std::vector<glm::vec3> surface = this->chunkSurface(
+                    chunkCoords + glm::ivec2(ci, cj), heights);
+            for (int j = j0; j < j1; j++) {
+                for (int i = i0; i < i1; i++) {
+                    int x = i + ci * n + apron;
+                    int z = j + cj * n + apron;
+                    height[x + edge * z] = surface[i + n * j].y;
+                }
+            }
+        }
     }
+    return height;
+}
 
-    return offsets;
+bool Terrain::loadColumnBounds(glm::ivec2 chunkCoords, glm::vec2 heights,
+                               std::vector<int>& top,
+                               std::vector<int>& bottom)
+{
+    int n = this->chunkExtent;
+    int edge = n + 2;
+    ChunkColumns neighbors[9];
+    for (int k = 0; k < 9; k++) {
+        glm::ivec2 c = chunkCoords + glm::ivec2(k % 3 - 1, k / 3 - 1);
+        if (!this->loadColumns(c, heights, neighbors[k])) {
+            return false;
+        }
+    }
+    for (int z = 0; z < edge; z++) {
+        for (int x = 0; x < edge; x++) {
+            // Which of the 3x3 chunks the column is in, and where
+            int ci = x == 0 ? 0 : (x == edge - 1 ? 2 : 1);
+            int cj = z == 0 ? 0 : (z == edge - 1 ? 2 : 1);
+            int i = x - 1 - (ci - 1) * n;
+            int j = z - 1 - (cj - 1) * n;
+            const ChunkColumns& columns = neighbors[ci + 3 * cj];
+            top[x + edge * z] = columns.top[i + n * j];
+            bottom[x + edge * z] =
+                    columns.top[i + n * j] - columns.depth[i + n * j];
+        }
+    }
+    return true;
 }
 
+ChunkVolume Terrain::getChunkVolume(glm::ivec2 chunkCoords, glm::vec2 heights)
+{
+    int n = this->chunkExtent;
+
+    // Column top and bottom over the chunk plus its one-block apron; a
+    // column reaches down to its lowest neighbor's surface
+    int edge = n + 2;
+    std::vector<int> top(edge * edge), bottom(edge * edge);
+    if (!this->loadColumnBounds(chunkCoords, heights, top, bottom)) {
+        // Filler depth needs the neighbors' heights, so the one-block apron
+        // of the volume needs a two-column apron of heights
+        int hEdge = n + 4;
+        std::vector<float> height =
+                this->surfaceHeights(chunkCoords, heights, 2);
+        ScopedTimer timer(kZoneSeams);
+        for (int z = 0; z < edge; z++) {
+            for (int x = 0; x < edge; x++) {
+                int h = (x + 1) + hEdge * (z + 1);
+                float low = std::min(
+                        std::min(height[h - 1], height[h + 1]),
+                        std::min(height[h - hEdge], height[h + hEdge]));
+                int c = x + edge * z;
+                top[c] = (int)height[h];
+                bottom[c] = top[c] - fillerDepth(height[h], low);
+            }
+        }
+    }
+    int yMin = *std::min_element(bottom.begin(), bottom.end());
+    int yMax = *std::max_element(top.begin(), top.end());
+
+    ChunkVolume volume(glm::ivec3(chunkCoords.x * n - 1, yMin,
+                                  chunkCoords.y * n - 1),
+                       glm::ivec3(edge, yMax - yMin + 1, edge));
+    for (int z = 0; z < edge; z++) {
+        for (int x = 0; x < edge; x++) {
+            for (int y = bottom[x + edge * z]; y <= top[x + edge * z]; y++) {
+                volume.set(glm::ivec3(x, y - yMin, z), blockMaterial(y));
+            }
+        }
+    }
+    return volume;
+}
 
-std::vector<float> Terrain::getSeedsForRender(glm::vec3 camCoords){
+ChunkMesh Terrain::getChunkMesh(glm::ivec2 chunkCoords, glm::vec2 heights)
+{
+    return greedyMesh(this->getChunkVolume(chunkCoords, heights),
+                      this->getChunk(chunkCoords).texSeedMap());
+}
+
+ChunkMesh Terrain::getLodMesh(glm::ivec2 chunkCoords, glm::vec2 heights,
+                              int step)
+{
+    int n = this->chunkExtent;
+    int m = n / step; // Cells along the chunk's edge
+    std::vector<glm::vec3> surface = this->chunkSurface(chunkCoords, heights);
+    std::vector<int> top(m * m, std::numeric_limits<int>::min());
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            int& cell = top[i / step + m * (j / step)];
+            cell = std::max(cell, (int)surface[i + n * j].y);
+        }
+    }
 
+    // Local cell (x, y, z) is cell (x - 1, z - 1) at height y + yMin; the
+    // apron stays air, so the chunk's sides are always walled
+    int yMin = (int)floor(heights.x);
+    int yMax = *std::max_element(top.begin(), top.end());
+    ChunkVolume volume(glm::ivec3(-1, yMin, -1),
+                       glm::ivec3(m + 2, yMax - yMin + 1, m + 2));
+    for (int z = 0; z < m; z++) {
+        for (int x = 0; x < m; x++) {
+            for (int y = yMin; y <= top[x + m * z]; y++) {
+                volume.set(glm::ivec3(x + 1, y - yMin, z + 1),
+                           blockMaterial(y));
+            }
+        }
+    }
+    ChunkMesh mesh = greedyMesh(volume,
+                                columnSeeds(this->getChunk(chunkCoords)
+                                                    .getTexSeed(),
+                                            m * m));
+
+    // Cells to world space; y is already in blocks
+    glm::vec2 origin(chunkCoords * n);
+    for (glm::vec4& v : mesh.vertices) {
+        v.x = origin.x + v.x * step;
+        v.z = origin.y + v.z * step;
+    }
+    return mesh;
+}
+
+std::vector<LodLevel> lodLevels(int viewRadius, int maxRadius,
+                                int chunkExtent)
+{
+    std::vector<LodLevel> levels(1, LodLevel{1, viewRadius});
+    while (levels.back().radius < maxRadius) {
+        LodLevel last = levels.back();
+        int step = 2 * last.step;
+        if (last.step > 1 &&
+            (last.step * 8 > chunkExtent || chunkExtent % step != 0)) {
+            levels.back().radius = maxRadius; // Cells are as large as allowed
+            break;
+        }
+        if (chunkExtent % step != 0) {
+            break; // Chunks cannot be split into cells at all
+        }
+        int radius = std::max(2 * last.radius, last.radius + 2);
+        levels.push_back(LodLevel{step, std::min(radius, maxRadius)});
+    }
+    return levels;
+}
+
+std::vector<glm::vec3> Terrain::getOffsetsForRender(glm::vec3 camCoords,
+                                                    glm::vec2 heights)
+{
     glm::ivec2 center = this->getChunkCoords(camCoords);
-    std::vector<float> seeds;
-    int offsetSize = 5 * this->chunkExtent;
-    seeds.resize(offsetSize * offsetSize);
+    std::vector<glm::vec3> offsets = this->viewSurface(center, heights);
 
-    for (int i = 0; i < 5; i++) {
-        for (int j = 0; j < 5; j++) {
-            glm::ivec2 c(center + glm::ivec2(i - 2, j - 2)); // Chunk's indices
+    // Fill seams
+    fixNeighborGaps(offsets, this->viewEdge());
+    return offsets;
+}
+
+
+std::vector<float> Terrain::getSeedsForRender(glm::vec3 camCoords,
+                                              size_t nInstances)
+{
+    glm::ivec2 center = this->getChunkCoords(camCoords);
+    std::vector<float> seeds;
+    int side = 2 * this->viewRadius + 1;
+    int offsetSize = this->viewEdge();
+    seeds.resize(std::max(nInstances, (size_t)offsetSize * offsetSize),
+                 kFillerSeed);
+
+    for (int i = 0; i < side; i++) {
+        for (int j = 0; j < side; j++) {
+            glm::ivec2 c(center + glm::ivec2(i - this->viewRadius,
+                                             j - this->viewRadius));
             std::vector<float> cSeeds = this->getChunk(c).texSeedMap();
 
             // Map into offsets at the right locations
@@ -361,5 +554,6 @@ std::vector<float> Terrain::getSeedsForRender(glm::vec3 camCoords){
             }
         }
     }
+    seeds.resize(nInstances);
     return seeds;
 }
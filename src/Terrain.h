@@ -5,6 +5,7 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
 #include <unordered_map>
@@ -12,6 +13,11 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
+#include "chunkcolumns.h"
+#include "fractalnoise.h"
+#include "lrucache.h"
+#include "mesher.h"
+#include "regionfile.h"
 class Terrain;
 
 // *** INDEXING CONVENTION *** //
@@ -40,39 +46,165 @@ class Terrain;
 
 */
 
+// The noise terrain heights come from: two octaves, 2 and 4 lattice cells
+// per chunk edge, the second at a quarter of the weight, on [0, 1.25 / 1.5]
+constexpr int kTerrainOctaves = 2;
+typedef FractalNoise<kTerrainOctaves> TerrainNoise;
+TerrainNoise terrainNoise(uint64_t worldSeed);
+
 // A chunk is a finite-sized (16x16?) size of cubes
 class Chunk {
     uint32_t tex_seed;
-    glm::vec2 O1grad[4];
-    glm::vec2 O2grad[9];
+    uint64_t world_seed;
 
     public:
-    Chunk(const glm::ivec2& location, int extent, std::mt19937& gen, Terrain* T);
+    // Depends only on the arguments; any chunk can be built on any thread
+    Chunk(const glm::ivec2& location, int extent, uint64_t worldSeed);
 
+    // terrainNoise() over the chunk, in the single-index convention
     std::vector<float> genPerlinNoise() const;
     std::vector<float> texSeedMap() const;
+    uint32_t getTexSeed() const { return tex_seed; }
 
     glm::ivec2 loc;     // Coordinates of the bottom-left (x,z) corner
     int extent;        // Number of blocks in the x and z edges.
                        // both values should be powers of two.
 };
 
-//
+// Append filler cubes below every surface cube that sits more than one unit
+// above one of its four neighbors, down to just above the lowest of them.
+// chunkExtent is the row length of surfaceMap; rows do not wrap.
+void fixNeighborGaps(std::vector<glm::vec3>& surfaceMap, int chunkExtent);
+
+// Everything the renderer needs for one chunk: its columns (surface cubes
+// and the fillers that close the gaps to its neighbors), and optionally the
+// same blocks as a greedy mesh
+struct ChunkData {
+    glm::ivec2 coords;
+    ChunkColumns columns;
+    ChunkBlocks blocks; // blocksFromColumns(columns), unless a LOD chunk
+    ChunkMesh mesh; // Empty unless requested
+    int lodStep = 1; // Above 1, mesh is a getLodMesh() and columns are empty
+};
+
+/* Distant chunks are drawn as downsampled meshes, one ring of chunks per
+   level of detail: level k covers the chunks within radius of the view
+   center (Chebyshev distance, in chunks) that are outside level k - 1, with
+   cells of step x step columns. Level 0 is the full-detail view. */
+struct LodLevel {
+    int step;
+    int radius;
+};
+// Level 0 is (1, viewRadius). Each further level doubles the cell size and
+// at least doubles the radius; once cells are a quarter of the chunk's edge
+// they stop growing and the last level reaches maxRadius. Steps always
+// divide chunkExtent. Only level 0 if maxRadius <= viewRadius or chunkExtent
+// is odd.
+std::vector<LodLevel> lodLevels(int viewRadius, int maxRadius,
+                                int chunkExtent);
+
+// Per-chunk height fields (single-index convention), keyed by chunk coords
+typedef LruCache<glm::ivec2, std::vector<float>> HeightCache;
+
+/* Terrain is safe to use from several threads at once. Chunks are a pure
+   function of (seed, coordinates) and are rebuilt on demand; only the caches
+   are shared, guarded by cacheMutex. Noise is always computed outside the
+   lock, so two threads may occasionally generate the same chunk; the results
+   are identical and the second insert simply wins. */
 class Terrain {
-    std::unordered_map<glm::ivec2, Chunk, std::hash<glm::ivec2>,
-                       std::equal_to<glm::ivec2>>
-            chunkMap;
-    std::mt19937 gen;
-    int chunkExtent = 32;
+    uint64_t seed;
+    int chunkExtent;
+    int viewRadius; // Chunks drawn on each side of the center chunk
+
+    // noiseCache holds raw Chunk::genPerlinNoise() output, surfaceCache holds
+    // the same noise after blending with the four neighbors' edges. Both are
+    // in [0,1] and independent of the render heights, so a chunk that has
+    // been seen once never needs its noise recomputed until it is evicted.
+    HeightCache noiseCache;
+    HeightCache surfaceCache;
+    mutable std::mutex cacheMutex;
+
+    // Both return copies; a reference into a shared cache could be evicted
+    // by another thread while it is being read.
+    std::vector<float> chunkNoise(glm::ivec2 chunkCoords);
+    std::vector<float> blendedNoise(glm::ivec2 chunkCoords);
+
+    // Saved chunks, tried before generating columns or volumes
+    std::shared_ptr<RegionStore> regions;
+    bool loadColumns(glm::ivec2 chunkCoords, glm::vec2 heights,
+                     ChunkColumns& columns);
+    // Column tops and bottoms for getChunkVolume(), if the chunk and all
+    // eight neighbors are saved
+    bool loadColumnBounds(glm::ivec2 chunkCoords, glm::vec2 heights,
+                          std::vector<int>& top, std::vector<int>& bottom);
 
     public:
-    Terrain(uint64_t seed) : gen(seed) {}
-    const Chunk& getChunk(glm::ivec2);
+    static constexpr size_t kDefaultCacheBytes = 16 << 20; // Per cache
+    static constexpr int kDefaultViewRadius = 2;           // 5x5 chunks
+    static constexpr float kFillerSeed = 1.0f; // Texture seed of seam fillers
+    // Heights the renderer, terrain_pregen and the tools generate chunks
+    // with; region files are only valid for the heights they were saved at
+    static const glm::vec2 kRenderHeights;
+
+    Terrain(uint64_t seed, int chunkExtent = 32)
+        : seed(seed), chunkExtent(chunkExtent),
+          viewRadius(kDefaultViewRadius), noiseCache(kDefaultCacheBytes),
+          surfaceCache(kDefaultCacheBytes)
+    {
+    }
+    int getChunkExtent() const { return chunkExtent; }
+
+    // Not synchronized: set the radius before handing the Terrain to
+    // worker threads. The cache budgets are not adjusted automatically.
+    void setViewRadius(int radius);
+    int getViewRadius() const { return viewRadius; }
+    // Cubes along one edge of a view
+    int viewEdge() const { return (2 * viewRadius + 1) * chunkExtent; }
+    Chunk getChunk(glm::ivec2) const;
+
+    // Not synchronized, like setViewRadius(). Only used for the heights the
+    // store was written for.
+    void setRegionStore(std::shared_ptr<RegionStore> store);
+    uint64_t getSeed() const { return seed; }
+
+    void setCacheBudget(size_t bytesPerCache);
+    CacheStats noiseCacheStats() const;
+    CacheStats surfaceCacheStats() const;
+
+    // Make sure the chunk's blended surface is cached (for worker threads)
+    void prefetchSurface(glm::ivec2 chunkCoords);
+    bool hasSurface(glm::ivec2 chunkCoords) const;
 
     std::vector<glm::vec3> chunkSurface(glm::ivec2 chunkCoords, glm::vec2 heights);
+    // Seams are filled against the neighboring chunks' surfaces, so the
+    // result does not depend on which other chunks are in view
+    ChunkColumns getChunkColumns(glm::ivec2 chunkCoords, glm::vec2 heights);
+    // Rounded surface heights of the chunk and an apron of that many columns
+    // (at most chunkExtent) of its eight neighbors, single-index convention
+    // with rows of chunkExtent + 2 * apron
+    std::vector<float> surfaceHeights(glm::ivec2 chunkCoords,
+                                      glm::vec2 heights, int apron);
+    // The chunk's surface and filler blocks, with a one-block apron
+    ChunkVolume getChunkVolume(glm::ivec2 chunkCoords, glm::vec2 heights);
+    ChunkMesh getChunkMesh(glm::ivec2 chunkCoords, glm::vec2 heights);
+    /* The chunk with each step x step block of columns merged into one cell
+       as tall as its highest column, as a closed mesh: cells reach down to
+       the lowest render height and the chunk's sides are walled down to it.
+       A coarse chunk therefore never leaves a gap next to a finer one, and
+       a full-detail chunk's border columns never reach below its coarse
+       neighbor's cells. step must divide the chunk extent. */
+    ChunkMesh getLodMesh(glm::ivec2 chunkCoords, glm::vec2 heights,
+                         int step);
     glm::ivec2 getChunkCoords(glm::vec3 worldCoords) const;
+    glm::vec3 getChunkCenter(glm::ivec2 chunkCoords) const;
+    // The surface of the chunks within the view radius of center, in the
+    // single-index convention over the whole view, before seams are filled
+    std::vector<glm::vec3> viewSurface(glm::ivec2 center, glm::vec2 heights);
+    // One entry per cube to draw: the view surface followed by seam fillers
     std::vector<glm::vec3> getOffsetsForRender(glm::vec3 camCoords, glm::vec2 heights);
-    std::vector<float> getSeedsForRender(glm::vec3 camCoords);
+    // Seeds for the first nInstances offsets; fillers get kFillerSeed
+    std::vector<float> getSeedsForRender(glm::vec3 camCoords,
+                                         size_t nInstances);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "blocktextures.h"
+#include <glm/glm.hpp>
+#include "Terrain.h"
+
+constexpr int BlockTextures::kTypes;
+constexpr int BlockTextures::kVariants;
+constexpr int BlockTextures::kSize;
+
+namespace {
+// The colors cube.frag multiplies its noise by
+const glm::vec3 kTypeColors[BlockTextures::kTypes] = {
+        glm::vec3(0.1, 0.4, 0.8), // Water
+        glm::vec3(0.3, 0.6, 0.1), // Grass
+        glm::vec3(1.0, 1.0, 1.0), // Snow
+};
+// Keeps the tiles' gradients apart from the terrain's
+constexpr uint64_t kTextureSeedSalt = 0x7e97u;
+}
+
+BlockTextures bakeBlockTextures(uint64_t worldSeed)
+{
+    constexpr int n = BlockTextures::kSize;
+    BlockTextures textures;
+    textures.texels.resize(4 * n * n * BlockTextures::layers());
+    uint8_t* out = textures.texels.data();
+    const float maxNoise = terrainNoise(worldSeed).maxValue();
+    for (int type = 0; type < BlockTextures::kTypes; type++) {
+        for (int v = 0; v < BlockTextures::kVariants; v++) {
+            Chunk tile(glm::ivec2(v, type), n, worldSeed ^ kTextureSeedSalt);
+            std::vector<float> noise = tile.genPerlinNoise();
+            for (float x : noise) {
+                float col = x / maxNoise;
+                glm::vec3 c = glm::clamp(col * kTypeColors[type] + 0.1f,
+                                         0.0f, 1.0f);
+                for (int k = 0; k < 3; k++) {
+                    *out++ = (uint8_t)(c[k] * 255.0f + 0.5f);
+                }
+                *out++ = 255;
+            }
+        }
+    }
+    return textures;
+}
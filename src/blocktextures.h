@@ -0,0 +1,34 @@
+#ifndef BLOCKTEXTURES_H
+#define BLOCKTEXTURES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* The noise cube.frag computes per fragment, baked once on the CPU into the
+   layers of a texture array instead.
+
+   Each block type other than air gets kVariants tiles of
+   Chunk::genPerlinNoise(), each kSize texels square, already tinted with the
+   type's color. A fragment samples the tile its instance seed picks at its
+   position on the face, so each block face shows one whole tile, repeated
+   across greedy mesh quads. Layer type * kVariants + variant holds the
+   variant'th tile of type. */
+struct BlockTextures {
+    // Water, grass, snow: the BlockMaterial types after air, in order
+    static constexpr int kTypes = 3;
+    // Tiles per type; must match VARIANTS in cube.frag
+    static constexpr int kVariants = 16;
+    static constexpr int kSize = 16;
+
+    // RGBA8, kSize x kSize per layer, layer after layer
+    std::vector<uint8_t> texels;
+
+    static constexpr int layers() { return kTypes * kVariants; }
+    size_t bytes() const { return texels.size(); }
+};
+
+// Depends only on the world seed
+BlockTextures bakeBlockTextures(uint64_t worldSeed);
+
+#endif
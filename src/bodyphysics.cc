@@ -0,0 +1,92 @@
+#include "bodyphysics.h"
+#include <algorithm>
+
+CollisionType collideBlock(const Aabb& body, const glm::vec3& cube)
+{
+    constexpr float eps = kContactBand;
+    float minX = cube.x;
+    float maxX = minX + 1.0;
+    float minZ = cube.z;
+    float maxZ = minZ + 1.0;
+    float minY = cube.y;
+    float maxY = cube.y + 1.0;
+
+    float bodyBot = body.min.y;
+    float bodyTop = body.max.y;
+    float bodyMinX = body.min.x;
+    float bodyMaxX = body.max.x;
+    float bodyMinZ = body.min.z;
+    float bodyMaxZ = body.max.z;
+
+    CollisionType ct = NONE;
+
+    bool MaxYCross = (bodyBot < (maxY + eps)) &&
+                     (bodyTop > maxY); // Body crosses maxY
+    bool MinYCross = (bodyTop > (minY - eps)) &&
+                     (bodyBot < minY); // Body crosses minY
+    bool MaxXCross = (bodyMinX < (maxX - eps)) && ((bodyMaxX - eps) > maxX);
+    bool MaxZCross = (bodyMinZ < (maxZ - eps)) && ((bodyMaxZ - eps) > maxZ);
+    bool MinXCross = ((bodyMaxX - eps) > minX) && (bodyMinX < (minX - eps));
+    bool MinZCross = ((bodyMaxZ - eps) > minZ) && (bodyMinZ < (minZ - eps));
+
+    // The body is inbounds if it crosses an edge or is entirely within the
+    // cell
+    bool inBoundsY = (bodyBot < maxY && bodyBot > minY) ||
+                     (bodyTop < maxY && bodyTop > minY) ||
+                     (bodyBot > minY && bodyTop < maxY);
+    bool inBoundsX = (bodyMinX < maxX && bodyMinX > minX) ||
+                     (bodyMaxX < maxX && bodyMaxX > minX) ||
+                     (bodyMaxX < maxX && bodyMinX > minX);
+    bool inBoundsZ = (bodyMinZ < maxZ && bodyMinZ > minZ) ||
+                     (bodyMaxZ < maxZ && bodyMaxZ > minZ) ||
+                     (bodyMaxZ < maxZ && bodyMinZ > minZ);
+
+    if (MaxYCross && inBoundsX && inBoundsZ) {
+        ct = ct | FLOOR;
+    }
+    if (MinYCross && inBoundsX && inBoundsZ) {
+        ct = ct | CEIL;
+    }
+    if (MaxXCross && inBoundsY && inBoundsZ) {
+        ct = ct | MINX;
+    }
+    if (MinXCross && inBoundsY && inBoundsZ) {
+        ct = ct | MAXX;
+    }
+    if (MaxZCross && inBoundsY && inBoundsX) {
+        ct = ct | MINZ;
+    }
+    if (MinZCross && inBoundsY && inBoundsX) {
+        ct = ct | MAXZ;
+    }
+    return ct;
+}
+
+float resolveContact(CollisionType contact, const Aabb& body,
+                     const glm::vec3& cube, glm::vec3& velocity)
+{
+    float lift = 0.0f;
+    if (contact & FLOOR) {
+        // If we are falling, make sure we don't fall too far
+        if (velocity.y < -kSnapSpeed) {
+            lift = cube.y + 1.0f + kContactBand / 2 - body.min.y;
+        }
+        velocity.y = std::max(0.0f, velocity.y);
+    }
+    if (contact & CEIL) {
+        velocity.y = std::min(0.0f, velocity.y);
+    }
+    if (contact & MINX) {
+        velocity.x = std::max(0.0f, velocity.x);
+    }
+    if (contact & MAXX) {
+        velocity.x = std::min(0.0f, velocity.x);
+    }
+    if (contact & MINZ) {
+        velocity.z = std::max(0.0f, velocity.z);
+    }
+    if (contact & MAXZ) {
+        velocity.z = std::min(0.0f, velocity.z);
+    }
+    return lift;
+}
@@ -0,0 +1,74 @@
+#ifndef BODYPHYSICS_H
+#define BODYPHYSICS_H
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include "frustum.h"
+
+/* The rules every simulated body follows against the terrain, the camera
+   and entities alike.
+
+   A body is a box. Each step it falls at kGravity, keeps kDragPerSecond of
+   its velocity per second, and stops once slower than kRestSpeed. A solid
+   block it touches takes away the velocity into the touching face: the
+   body touches a face when it crosses it or is within kContactBand of it
+   outside, and overlaps the face in the other two axes. A body landing
+   faster than kSnapSpeed is put back on top of the block, so it cannot
+   sink through in one step. */
+
+enum CollisionType {
+    NONE = 0,
+    CEIL = 1,
+    FLOOR = 2,
+    MINX = 4,
+    MAXX = 8,
+    MINZ = 16,
+    MAXZ = 32,
+    WALL = 64
+};
+inline CollisionType operator|(CollisionType a, CollisionType b)
+{
+    return static_cast<CollisionType>(static_cast<int>(a) |
+                                      static_cast<int>(b));
+}
+inline CollisionType operator&(CollisionType a, CollisionType b)
+{
+    return static_cast<CollisionType>(static_cast<int>(a) &
+                                      static_cast<int>(b));
+}
+
+constexpr float kGravity = 58.8;      // Blocks/s^2: 0.98 per tick at 60 Hz
+constexpr double kDragPerSecond = 0.01;
+constexpr float kRestSpeed = 0.05;    // Blocks/s
+constexpr float kContactBand = 0.10;  // Blocks
+constexpr float kSnapSpeed = 10.0;    // Blocks/s
+
+// The factor drag leaves velocity at after timestep seconds
+inline float dragFactor(double timestep)
+{
+    return std::pow(kDragPerSecond, timestep);
+}
+
+// Velocity after one step of gravity (gravity * timestep) and drag
+inline glm::vec3 accelerate(glm::vec3 velocity, float gravityStep,
+                            float drag)
+{
+    velocity += glm::vec3(0.0f, -gravityStep, 0.0f);
+    velocity *= drag;
+    if (glm::length(velocity) < kRestSpeed) {
+        velocity = glm::vec3(0.0f);
+    }
+    return velocity;
+}
+
+// The faces of the unit block with min corner cube that body touches, each
+// named for the side of the body it is on
+CollisionType collideBlock(const Aabb& body, const glm::vec3& cube);
+
+// Drops the velocity into each face in contact and returns how far to move
+// the body up: onto the block if it lands faster than kSnapSpeed, else 0
+float resolveContact(CollisionType contact, const Aabb& body,
+                     const glm::vec3& cube, glm::vec3& velocity);
+
+#endif
@@ -21,111 +21,16 @@ float zoom_speed = 0.1f;
 }; // namespace
 
 
-enum CollisionType {
-    NONE = 0,
-    CEIL = 1,
-    FLOOR = 2,
-    MINX = 4,
-    MAXX = 8,
-    MINZ = 16,
-    MAXZ = 32,
-    WALL = 64
-};
-inline CollisionType operator|(CollisionType a, CollisionType b)
-{
-    return static_cast<CollisionType>(static_cast<int>(a) |
-                                      static_cast<int>(b));
-}
-inline CollisionType operator&(CollisionType a, CollisionType b)
-{
-    return static_cast<CollisionType>(static_cast<int>(a) &
-                                      static_cast<int>(b));
-}
-
-
-constexpr float eps = 0.10;
 constexpr float camH = 1.75;
 constexpr float camR = 0.49;
-CollisionType collide(const glm::vec3& location, const glm::vec3& Cmin)
+// The camera's body: the box under the eye
+Aabb cameraBody(const glm::vec3& eye)
 {
-    float minX = Cmin.x;
-    float maxX = minX + 1.0;
-    float minZ = Cmin.z;
-    float maxZ = minZ + 1.0;
-    float minY = Cmin.y;
-    float maxY = Cmin.y + 1.0;
-
-    float camBot = location.y - camH;
-    float camTop = location.y;
-    float camMinX = location.x - camR;
-    float camMaxX = location.x + camR;
-    float camMinZ = location.z - camR;
-    float camMaxZ = location.z + camR;
-
-    CollisionType ct = NONE;
-
-    bool MaxYCross =
-            (camBot < (maxY + eps)) && (camTop > maxY); // Camera crosses maxY
-    bool MinYCross =
-            (camTop > (minY - eps)) && (camBot < minY); // Camera crosses minY
-    bool MaxXCross = (camMinX < (maxX - eps)) && ((camMaxX - eps) > maxX);
-    bool MaxZCross = (camMinZ < (maxZ - eps)) && ((camMaxZ - eps) > maxZ);
-    bool MinXCross = ((camMaxX - eps) > minX) && (camMinX < (minX - eps));
-    bool MinZCross = ((camMaxZ - eps) > minZ) && (camMinZ < (minZ - eps));
-
-    // Cylinder is inbounds if it crosses an edge or is entirely within the cell
-    bool inBoundsY = (camBot < maxY && camBot > minY) ||
-                     (camTop < maxY && camTop > minY) ||
-                     (camBot > minY && camTop < maxY);
-    bool inBoundsX = (camMinX < maxX && camMinX > minX) ||
-                     (camMaxX < maxX && camMaxX > minX) ||
-                     (camMaxX < maxX && camMinX > minX);
-    bool inBoundsZ = (camMinZ < maxZ && camMinZ > minZ) ||
-                     (camMaxZ < maxZ && camMaxZ > minZ) ||
-                     (camMaxZ < maxZ && camMinZ > minZ);
-
-    if (MaxYCross && inBoundsX && inBoundsZ) {
-        /*
-        cout << "Collision of " << glm::to_string(location) << " with "
-             << glm::to_string(Cmin) << " of type FLOOR" << std::endl; */
-        ct = ct | FLOOR;
-    }
-    if (MinYCross && inBoundsX && inBoundsZ) {
-        /*
-        cout << "Collision of " << glm::to_string(location) << " with "
-             << glm::to_string(Cmin) << " of type CEIL" << std::endl; */
-        ct = ct | CEIL;
-    }
-    if (MaxXCross && inBoundsY && inBoundsZ) {
-        /*
-        cout << "Collision of " << glm::to_string(location) << " with "
-             << glm::to_string(Cmin) << " of type MINX" << std::endl; */
-        ct = ct | MINX;
-    }
-    if (MinXCross && inBoundsY && inBoundsZ) {
-        /*
-        cout << "Collision of " << glm::to_string(location) << " with "
-             << glm::to_string(Cmin) << " of type MAXX" << std::endl; */
-        ct = ct | MAXX;
-    }
-    if (MaxZCross && inBoundsY && inBoundsX) {
-        /*
-        cout << "Collision of " << glm::to_string(location) << " with "
-             << glm::to_string(Cmin) << " of type MINZ" << std::endl; */
-        ct = ct | MINZ;
-    }
-    if (MinZCross && inBoundsY && inBoundsX) {
-        /*
-        cout << "Collision of " << glm::to_string(location) << " with "
-             << glm::to_string(Cmin) << " of type MAXZ" << std::endl;*/
-
-        ct = ct | MAXZ;
-    }
-    return ct;
+    return Aabb{eye - glm::vec3(camR, camH, camR),
+                eye + glm::vec3(camR, 0.0f, camR)};
 }
 
 
-
 Camera::Camera()
 {
     update_internal_data();
@@ -137,6 +42,18 @@ glm::mat4 Camera::get_view_matrix() const
     return world_to_cam_;
 }
 
+glm::mat4 Camera::get_view_matrix(float alpha) const
+{
+    glm::mat4 cam_to_world = cam_to_world_;
+    cam_to_world[3] = glm::vec4(glm::mix(previous_eye_, eye_, alpha), 1.0f);
+    return glm::inverse(cam_to_world);
+}
+
+void Camera::begin_tick()
+{
+    previous_eye_ = eye_;
+}
+
 void Camera::lm_rotate_cam(double screendX, double screendY)
 {
     glm::vec2 amt = glm::normalize(glm::dvec2(screendX, screendY));
@@ -170,11 +87,16 @@ void Camera::lm_rotate_cam(double screendX, double screendY)
 
 void Camera::rm_zoom_cam(double screendY)
 {
+    // Mouse moves bypass the simulation, so they move both ends of the
+    // interpolation and show up at once
+    glm::vec3 delta = this->look_ * zoom_speed;
     if (screendY < 0) { // Zoom in
-        this->eye_ += this->look_ * zoom_speed;
+        this->eye_ += delta;
+        this->previous_eye_ += delta;
         camera_distance_ -= zoom_speed;
     } else {
-        this->eye_ -= this->look_ * zoom_speed;
+        this->eye_ -= delta;
+        this->previous_eye_ -= delta;
         camera_distance_ -= zoom_speed;
     }
     update_internal_data();
@@ -187,10 +109,11 @@ void Camera::mm_trans_cam(double screendX, double screendY)
     glm::vec3 camDir = amt[0] * right_ - amt[1] * up_;
 
     this->eye_ += camDir * pan_speed;
+    this->previous_eye_ += camDir * pan_speed;
     update_internal_data();
 }
 
-void Camera::lr_roll_cam(int direction, const std::vector<glm::vec3>& cubes)
+void Camera::lr_roll_cam(int direction, const CollisionGrid& cubes)
 {
     if (physics_mode)
         return;
@@ -205,8 +128,7 @@ void Camera::lr_roll_cam(int direction, const std::vector<glm::vec3>& cubes)
     update_internal_data();
 }
 
-void Camera::ud_move_cam(int direction,
-                         const std::vector<glm::vec3>& cubes)
+void Camera::ud_move_cam(int direction, const CollisionGrid& cubes)
 {
     if (physics_mode)
         return;
@@ -217,16 +139,9 @@ void Camera::ud_move_cam(int direction,
         this->eye_ -= pan_speed * this->up_;
     }
 
-    bool fail = false;
-
     // Coarse detection
     constexpr float coarseRadius = sqrt(camR * camR + camH * camH);
-    for (const auto& c : cubes) {
-        if (glm::length(c - this->eye_) < coarseRadius) {
-            fail = true;
-            break;
-        }
-    }
+    bool fail = cubes.anyWithin(this->eye_, coarseRadius);
 
     if(fail) {
         if (direction > 0) {
@@ -241,7 +156,7 @@ void Camera::ud_move_cam(int direction,
     }
 }
 
-void Camera::ws_walk_cam(int direction, const std::vector<glm::vec3>& cubes)
+void Camera::ws_walk_cam(int direction, const CollisionGrid& cubes)
 {
     if (physics_mode) {
         if (direction > 0) {
@@ -257,16 +172,9 @@ void Camera::ws_walk_cam(int direction, const std::vector<glm::vec3>& cubes)
         }
     }
 
-    bool fail = false;
-
     // Coarse detection
     constexpr float coarseRadius = sqrt(camR * camR + camH * camH);
-    for (const auto& c : cubes) {
-        if (glm::length(c - this->eye_) < coarseRadius) {
-            fail = true;
-            break;
-        }
-    }
+    bool fail = cubes.anyWithin(this->eye_, coarseRadius);
 
     if(fail and !physics_mode) {
         if (direction > 0) {
@@ -281,7 +189,7 @@ void Camera::ws_walk_cam(int direction, const std::vector<glm::vec3>& cubes)
     }
 }
 
-void Camera::ad_strafe_cam(int direction, const std::vector<glm::vec3>& cubes)
+void Camera::ad_strafe_cam(int direction, const CollisionGrid& cubes)
 {
     if (physics_mode) {
         if (direction > 0) {
@@ -297,16 +205,9 @@ void Camera::ad_strafe_cam(int direction, const std::vector<glm::vec3>& cubes)
         }
     }
 
-    bool fail = false;
-
     // Coarse detection
     constexpr float coarseRadius = sqrt(camR * camR + camH * camH);
-    for (const auto& c : cubes) {
-        if (glm::length(c - this->eye_) < coarseRadius) {
-            fail = true;
-            break;
-        }
-    }
+    bool fail = cubes.anyWithin(this->eye_, coarseRadius);
 
     if(fail and !physics_mode) {
         if (direction > 0) {
@@ -343,20 +244,16 @@ void Camera::update_internal_data()
 }
 
 void Camera::update_physics(double timestep, const Chunk& C,
-                            const std::vector<glm::vec3>& cubes)
+                            const CollisionGrid& cubes)
 {
     if (!physics_mode)
         return;
 
     constexpr float camH = 1.75;
     constexpr float camR = 0.5;
-    // Update camera velocity from gravity
-    this->velocity_ += glm::vec3(0.0f, -gravity, 0.0f);
-
-    // Update camera velocity from friction
-    this->velocity_ *= pow(0.01, timestep);
-    if (glm::length(this->velocity_) < 0.05)
-        this->velocity_ = glm::vec3(0.0);
+    // Update camera velocity from gravity and friction
+    this->velocity_ = accelerate(this->velocity_, (float)timestep * gravity,
+                                 dragFactor(timestep));
 
     // Update camera velocity from collisions
     std::vector<glm::vec3>
@@ -364,45 +261,17 @@ void Camera::update_physics(double timestep, const Chunk& C,
 
     // Coarse detection
     constexpr float coarseRadius = 1.5 + sqrt(camR * camR + camH * camH);
-    for (const auto& c : cubes) {
+    cubes.forEachNear(this->eye_, coarseRadius, [&](const glm::vec3& c) {
         if (glm::length(c - this->eye_) < coarseRadius) {
             coarseCollisions.push_back(c);
         }
-    }
+    });
 
     // Fine detection
-    CollisionType allColl = NONE;
     for (const auto& c : coarseCollisions) {
-        CollisionType coll = collide(this->eye_, c);
-
-        if (coll & FLOOR) {
-            // If we are falling, make sure we don't fall too far
-            if (this->velocity_.y < -10) {
-                this->eye_.y = c.y + camH + 1.0 + eps / 2;
-            }
-            this->velocity_.y = max(0.0f, this->velocity_.y);
-            allColl = allColl | FLOOR;
-        }
-        if (coll & CEIL) {
-            this->velocity_.y = min(0.0f, this->velocity_.y);
-            allColl = allColl | CEIL;
-        }
-        if (coll & MINX) {
-            this->velocity_.x = max(0.0f, this->velocity_.x);
-            allColl = allColl | MINX;
-        }
-        if (coll & MAXX) {
-            this->velocity_.x = min(0.0f, this->velocity_.x);
-            allColl = allColl | MAXX;
-        }
-        if (coll & MINZ) {
-            this->velocity_.z = max(0.0f, this->velocity_.z);
-            allColl = allColl | FLOOR;
-        }
-        if (coll & MAXZ) {
-            this->velocity_.z = min(0.0f, this->velocity_.z);
-            allColl = allColl | FLOOR;
-        }
+        Aabb body = cameraBody(this->eye_);
+        CollisionType coll = collideBlock(body, c);
+        this->eye_.y += resolveContact(coll, body, c, this->velocity_);
     }
 
     // Update camera position with velocity + explicit Euler
@@ -417,6 +286,16 @@ glm::vec3 Camera::getEye() const
     return eye_;
 }
 
+glm::vec3 Camera::getLook() const
+{
+    return look_;
+}
+
+glm::vec3 Camera::getVelocity() const
+{
+    return velocity_;
+}
+
 void Camera::jump()
 {
     this->velocity_ += glm::vec3(0.0f, 20.0f, 0.0f);
@@ -3,27 +3,33 @@
 
 #include <glm/glm.hpp>
 #include "Terrain.h"
+#include "bodyphysics.h"
+#include "collisiongrid.h"
 
 
 class Camera {
 public:
     glm::mat4 get_view_matrix() const;
+    // The view from between the last two simulation ticks: alpha 0 is the
+    // eye before the last tick, 1 the eye now. Orientation is always now.
+    glm::mat4 get_view_matrix(float alpha) const;
+    // Call before each simulation tick moves the camera
+    void begin_tick();
     void lm_rotate_cam(double screenX, double screenY);
     void rm_zoom_cam(double screendY);
     void mm_trans_cam(double screenX, double screenY);
-    void ws_walk_cam(int direction,
-                     const std::vector<glm::vec3>& cubes);
-    void ad_strafe_cam(int direction,
-                       const std::vector<glm::vec3>& cubes);
-    void lr_roll_cam(int direction,
-                     const std::vector<glm::vec3>& cubes);
-    void ud_move_cam(int direction,
-                     const std::vector<glm::vec3>& cubes);
-    void update_physics(double timestep, const Chunk& C, const std::vector<glm::vec3>& cubes);
+    void ws_walk_cam(int direction, const CollisionGrid& cubes);
+    void ad_strafe_cam(int direction, const CollisionGrid& cubes);
+    void lr_roll_cam(int direction, const CollisionGrid& cubes);
+    void ud_move_cam(int direction, const CollisionGrid& cubes);
+    void update_physics(double timestep, const Chunk& C,
+                        const CollisionGrid& cubes);
     bool physics_mode = true;
     void jump();
 
     glm::vec3 getEye() const;
+    glm::vec3 getLook() const;
+    glm::vec3 getVelocity() const;
 
     Camera();
     ~Camera() {};
@@ -33,13 +39,14 @@ private:
     glm::vec3 up_ = glm::vec3(0.0f, 1.0f, 0.0f);
     glm::vec3 true_up_ = glm::vec3(0.0f,1.0f,0.0f);
     glm::vec3 eye_ = glm::vec3(0.0f, 4.0f, camera_distance_);
+    glm::vec3 previous_eye_ = eye_; // Before the last tick
     glm::vec3 right_;
     glm::vec3 center_;
     glm::mat4 cam_to_world_;
     glm::mat4 world_to_cam_;
 
     glm::vec3 velocity_ = glm::vec3(0.0f,0.0f,0.0f);
-    float gravity = 0.98;
+    float gravity = kGravity;
     float friction = 1.0;
 
     void update_internal_data();
@@ -0,0 +1,314 @@
+#include "chunkblocks.h"
+#include <algorithm>
+
+constexpr int BlockSection::kEdge;
+constexpr int BlockSection::kBlocks;
+
+namespace {
+int floorDiv(int a, int n)
+{
+    return a >= 0 ? a / n : -((-a + n - 1) / n);
+}
+
+// The narrowest index width that can address size palette entries
+int bitsFor(int size)
+{
+    int bits = 0;
+    while ((1 << bits) < size) {
+        bits = bits == 0 ? 1 : 2 * bits;
+    }
+    return bits;
+}
+}
+
+uint8_t blockMaterial(int y)
+{
+    int top = y + 1;
+    if (top <= -9) {
+        return kWater;
+    }
+    if (top <= -7) {
+        return kGrass;
+    }
+    return kSnow;
+}
+
+BlockSection::BlockSection(const uint8_t* blocks)
+{
+    int entry[256];
+    std::fill(entry, entry + 256, -1);
+    for (int i = 0; i < kBlocks; i++) {
+        if (entry[blocks[i]] < 0) {
+            entry[blocks[i]] = this->palette.size();
+            this->palette.push_back(blocks[i]);
+        }
+    }
+    this->bits = bitsFor(this->palette.size());
+    if (this->bits > 0) {
+        this->indices.assign(kBlocks * this->bits / 64, 0);
+        for (int i = 0, bit = 0; i < kBlocks; i++, bit += this->bits) {
+            this->indices[bit >> 6] |= (uint64_t)entry[blocks[i]]
+                                       << (bit & 63);
+        }
+    }
+}
+
+void BlockSection::setPaletteIndex(int i, int p)
+{
+    int bit = i * this->bits;
+    uint64_t mask = (uint64_t)((1u << this->bits) - 1) << (bit & 63);
+    uint64_t& word = this->indices[bit >> 6];
+    word = (word & ~mask) | ((uint64_t)p << (bit & 63));
+}
+
+void BlockSection::resize(int newBits)
+{
+    std::vector<int> old(kBlocks, 0);
+    if (this->bits > 0) {
+        for (int i = 0; i < kBlocks; i++) {
+            old[i] = this->paletteIndex(i);
+        }
+    }
+    this->bits = newBits;
+    this->indices.assign(newBits == 0 ? 0 : kBlocks * newBits / 64, 0);
+    if (newBits > 0) {
+        for (int i = 0; i < kBlocks; i++) {
+            this->setPaletteIndex(i, old[i]);
+        }
+    }
+}
+
+void BlockSection::set(int x, int y, int z, uint8_t block)
+{
+    int i = index(x, y, z);
+    if (this->get(x, y, z) == block) {
+        return;
+    }
+    auto it = std::find(this->palette.begin(), this->palette.end(), block);
+    int p = it - this->palette.begin();
+    if (it == this->palette.end()) {
+        this->palette.push_back(block);
+        int needed = bitsFor(this->palette.size());
+        if (needed > this->bits) {
+            this->resize(needed); // A uniform section's blocks all get 0
+        }
+    }
+    this->setPaletteIndex(i, p);
+}
+
+void BlockSection::compact()
+{
+    if (this->bits == 0) {
+        return;
+    }
+    std::vector<int> used(this->palette.size(), 0);
+    for (int i = 0; i < kBlocks; i++) {
+        used[this->paletteIndex(i)]++;
+    }
+    // Old palette index to new, for the entries still in use
+    std::vector<int> remap(this->palette.size(), -1);
+    std::vector<uint8_t> kept;
+    for (size_t p = 0; p < this->palette.size(); p++) {
+        if (used[p] > 0) {
+            remap[p] = kept.size();
+            kept.push_back(this->palette[p]);
+        }
+    }
+    if (kept.size() == this->palette.size()) {
+        return;
+    }
+    std::vector<int> old(kBlocks);
+    for (int i = 0; i < kBlocks; i++) {
+        old[i] = remap[this->paletteIndex(i)];
+    }
+    this->palette = kept;
+    this->bits = bitsFor(kept.size());
+    this->indices.assign(this->bits == 0 ? 0 : kBlocks * this->bits / 64, 0);
+    if (this->bits > 0) {
+        for (int i = 0; i < kBlocks; i++) {
+            this->setPaletteIndex(i, old[i]);
+        }
+    }
+    this->palette.shrink_to_fit();
+    this->indices.shrink_to_fit();
+}
+
+size_t BlockSection::bytes() const
+{
+    return sizeof(*this) + this->palette.capacity() +
+           this->indices.capacity() * sizeof(uint64_t);
+}
+
+ChunkBlocks::ChunkBlocks(glm::ivec2 chunkCoords, int extent, int yMin,
+                         int yMax)
+{
+    constexpr int edge = BlockSection::kEdge;
+    int bottom = floorDiv(yMin, edge);
+    this->origin = glm::ivec3(chunkCoords.x * extent, bottom * edge,
+                              chunkCoords.y * extent);
+    this->extent = extent;
+    this->across = (extent + edge - 1) / edge;
+    this->layers = floorDiv(yMax, edge) - bottom + 1;
+    this->sections.resize(this->across * this->across * this->layers);
+}
+
+void ChunkBlocks::grow(int y)
+{
+    constexpr int edge = BlockSection::kEdge;
+    int perLayer = this->across * this->across;
+    if (y < 0) {
+        int added = floorDiv(-y + edge - 1, edge);
+        this->sections.insert(this->sections.begin(), added * perLayer,
+                              BlockSection());
+        this->layers += added;
+        this->origin.y -= added * edge;
+    } else if (y >= this->layers * edge) {
+        int added = y / edge - this->layers + 1;
+        this->sections.resize(this->sections.size() + added * perLayer);
+        this->layers += added;
+    }
+}
+
+bool ChunkBlocks::set(const glm::ivec3& p, uint8_t block)
+{
+    glm::ivec3 local = p - this->origin;
+    if (local.x < 0 || local.z < 0 || local.x >= this->extent ||
+        local.z >= this->extent) {
+        return false;
+    }
+    if (this->get(p) == block) {
+        return true; // Also keeps air from growing the stack
+    }
+    this->grow(local.y);
+    local = p - this->origin;
+    this->sections[this->sectionIndex(local)].set(local.x & 15, local.y & 15,
+                                                  local.z & 15, block);
+    return true;
+}
+
+void ChunkBlocks::compact()
+{
+    for (BlockSection& section : this->sections) {
+        section.compact();
+    }
+}
+
+int ChunkBlocks::uniformSections() const
+{
+    int n = 0;
+    for (const BlockSection& section : this->sections) {
+        n += section.uniform();
+    }
+    return n;
+}
+
+size_t ChunkBlocks::bytes() const
+{
+    size_t bytes = sizeof(*this);
+    for (const BlockSection& section : this->sections) {
+        bytes += section.bytes();
+    }
+    return bytes + (this->sections.capacity() - this->sections.size()) *
+                           sizeof(BlockSection);
+}
+
+Aabb ChunkBlocks::bounds() const
+{
+    Aabb box;
+    box.min = glm::vec3(this->origin);
+    box.max = box.min + glm::vec3(this->extent, this->getHeight(),
+                                  this->extent);
+    return box;
+}
+
+void ChunkBlocks::appendOffsets(std::vector<glm::vec3>& offsets) const
+{
+    glm::ivec3 p;
+    for (p.y = this->origin.y; p.y < this->origin.y + this->getHeight();
+         p.y++) {
+        for (p.z = this->origin.z; p.z < this->origin.z + this->extent;
+             p.z++) {
+            for (p.x = this->origin.x; p.x < this->origin.x + this->extent;
+                 p.x++) {
+                if (this->get(p) != kAir) {
+                    offsets.emplace_back(p);
+                }
+            }
+        }
+    }
+}
+
+void ChunkBlocks::appendInstances(std::vector<glm::vec4>& instances,
+                                  const std::vector<float>& seeds,
+                                  float fillerSeed) const
+{
+    glm::ivec3 p;
+    for (p.z = this->origin.z; p.z < this->origin.z + this->extent; p.z++) {
+        for (p.x = this->origin.x; p.x < this->origin.x + this->extent;
+             p.x++) {
+            int c = (p.x - this->origin.x) +
+                    this->extent * (p.z - this->origin.z);
+            bool covered = false; // Whether the block above is solid
+            for (p.y = this->origin.y + this->getHeight() - 1;
+                 p.y >= this->origin.y; p.y--) {
+                uint8_t block = this->get(p);
+                if (block != kAir) {
+                    float seed = covered ? fillerSeed : seeds[c];
+                    instances.emplace_back(glm::vec3(p),
+                                           blockAttribute(block, seed));
+                }
+                covered = block != kAir;
+            }
+        }
+    }
+}
+
+ChunkBlocks blocksFromColumns(const ChunkColumns& columns)
+{
+    int n = columns.extent;
+    if (n == 0) {
+        return ChunkBlocks();
+    }
+    int lo = 0, hi = 0;
+    for (int c = 0; c < n * n; c++) {
+        lo = c == 0 ? columns.top[c] - columns.depth[c]
+                    : std::min(lo, columns.top[c] - columns.depth[c]);
+        hi = c == 0 ? columns.top[c] : std::max(hi, (int)columns.top[c]);
+    }
+    // Section by section, each straight from a dense copy of its blocks
+    constexpr int edge = BlockSection::kEdge;
+    ChunkBlocks blocks(columns.coords(), n, lo, hi);
+    std::vector<uint8_t> dense(BlockSection::kBlocks);
+    for (int sy = 0; sy < blocks.layers; sy++) {
+        int y0 = blocks.origin.y + sy * edge;
+        for (int sz = 0; sz < blocks.across; sz++) {
+            for (int sx = 0; sx < blocks.across; sx++) {
+                std::fill(dense.begin(), dense.end(), (uint8_t)kAir);
+                for (int z = sz * edge; z < std::min(n, (sz + 1) * edge);
+                     z++) {
+                    for (int x = sx * edge; x < std::min(n, (sx + 1) * edge);
+                         x++) {
+                        int c = x + n * z;
+                        int bottom = std::max(y0, columns.top[c] -
+                                                          columns.depth[c]);
+                        int top = std::min(y0 + edge - 1, (int)columns.top[c]);
+                        for (int y = bottom; y <= top; y++) {
+                            dense[(x & 15) + edge * ((z & 15) +
+                                                     edge * (y - y0))] =
+                                    blockMaterial(y);
+                        }
+                    }
+                }
+                blocks.sections[sx + blocks.across *
+                                             (sz + blocks.across * sy)] =
+                        BlockSection(dense.data());
+            }
+        }
+    }
+    return blocks;
+}
+
+glm::ivec2 chunkOfBlock(const glm::ivec3& p, int extent)
+{
+    return glm::ivec2(floorDiv(p.x, extent), floorDiv(p.z, extent));
+}
@@ -0,0 +1,145 @@
+#ifndef CHUNKBLOCKS_H
+#define CHUNKBLOCKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "chunkcolumns.h"
+
+// Block types. Terrain generation bands them by height (blockMaterial());
+// from there on they are data, carried to the shaders in the seed attribute
+// (blockAttribute()).
+enum BlockMaterial : uint8_t { kAir = 0, kWater, kGrass, kSnow };
+uint8_t blockMaterial(int y);
+
+// The float the shaders take as in_seed for a block face: 2 * block + seed,
+// with seed in [0, 1]. The vertex shaders split it back into a flat block
+// type and the texture seed.
+inline float blockAttribute(uint8_t block, float seed)
+{
+    return 2.0f * block + seed;
+}
+
+/* A 16x16x16 cube of blocks as a palette of the block types it holds and
+   one bit-packed palette index per block. Indices are 1, 2, 4 or 8 bits
+   wide, as few as the palette needs, and never straddle two words. A
+   section of a single type (all air, all snow) has no indices at all. */
+class BlockSection {
+    std::vector<uint8_t> palette;  // Never empty
+    std::vector<uint64_t> indices; // 4096 * bits / 64 words, or none
+    int bits = 0;
+
+    static int index(int x, int y, int z) { return x + kEdge * (z + kEdge * y); }
+    int paletteIndex(int i) const
+    {
+        int bit = i * this->bits;
+        return (this->indices[bit >> 6] >> (bit & 63)) & ((1u << bits) - 1);
+    }
+    void setPaletteIndex(int i, int p);
+    // Repacks the indices at newBits per block
+    void resize(int newBits);
+
+    public:
+    static constexpr int kEdge = 16;
+    static constexpr int kBlocks = kEdge * kEdge * kEdge;
+
+    explicit BlockSection(uint8_t fill = kAir) : palette(1, fill) {}
+    // From kBlocks blocks, x fastest, then z, then y
+    explicit BlockSection(const uint8_t* blocks);
+
+    // x, y and z are in [0, kEdge)
+    uint8_t get(int x, int y, int z) const
+    {
+        return this->bits == 0 ? this->palette[0]
+                               : this->palette[this->paletteIndex(
+                                         index(x, y, z))];
+    }
+    void set(int x, int y, int z, uint8_t block);
+    // Drops palette entries no block uses any more and narrows the indices
+    // to match; a section left with one type becomes uniform
+    void compact();
+
+    bool uniform() const { return bits == 0; }
+    int paletteSize() const { return palette.size(); }
+    int indexBits() const { return bits; }
+    // Heap and inline bytes
+    size_t bytes() const;
+};
+
+class ChunkBlocks;
+ChunkBlocks blocksFromColumns(const ChunkColumns& columns);
+
+/* Every block of one chunk: a column of extent x extent blocks split into
+   16^3 sections, x fastest, then z, then y. Sections cover the chunk from
+   the bottom of its lowest section to the top of its highest; anything
+   above or below them is air, and set() adds sections as needed. Lookups
+   take world coordinates and are O(1). */
+class ChunkBlocks {
+    glm::ivec3 origin = glm::ivec3(0); // World position of local block (0,0,0)
+    int extent = 0; // Blocks along the chunk's x and z edges
+    int across = 0; // Sections along the x and z edges
+    int layers = 0; // Sections stacked in y
+    std::vector<BlockSection> sections;
+
+    int sectionIndex(const glm::ivec3& local) const
+    {
+        return (local.x >> 4) + this->across * ((local.z >> 4) +
+                                                this->across * (local.y >> 4));
+    }
+    // Adds air sections until local y is inside the stack
+    void grow(int y);
+
+    friend ChunkBlocks blocksFromColumns(const ChunkColumns& columns);
+
+    public:
+    ChunkBlocks() {}
+    // All air from yMin to yMax (inclusive)
+    ChunkBlocks(glm::ivec2 chunkCoords, int extent, int yMin, int yMax);
+
+    uint8_t get(const glm::ivec3& p) const
+    {
+        glm::ivec3 local = p - this->origin;
+        if (local.x < 0 || local.z < 0 || local.x >= this->extent ||
+            local.z >= this->extent || local.y < 0 ||
+            local.y >= this->layers * BlockSection::kEdge) {
+            return kAir;
+        }
+        return this->sections[this->sectionIndex(local)].get(
+                local.x & 15, local.y & 15, local.z & 15);
+    }
+    // Returns false if p is outside the chunk's columns
+    bool set(const glm::ivec3& p, uint8_t block);
+    void compact();
+
+    bool empty() const { return sections.empty(); }
+    glm::ivec3 getOrigin() const { return origin; }
+    int getExtent() const { return extent; }
+    // Blocks from the bottom of the lowest section to the top of the highest
+    int getHeight() const { return layers * BlockSection::kEdge; }
+    // The box around every section
+    Aabb bounds() const;
+    int sectionCount() const { return sections.size(); }
+    int uniformSections() const;
+    // Heap and inline bytes held by this chunk
+    size_t bytes() const;
+
+    // Appends one offset per solid block
+    void appendOffsets(std::vector<glm::vec3>& offsets) const;
+    // The same blocks as (offset, blockAttribute()). Blocks with air above
+    // them get their column's seed (single-index convention), the others
+    // fillerSeed, as in ChunkColumns::appendInstances().
+    void appendInstances(std::vector<glm::vec4>& instances,
+                         const std::vector<float>& seeds,
+                         float fillerSeed) const;
+};
+
+// The blocks of a chunk's columns: each surface block and its fillers,
+// typed by blockMaterial()
+ChunkBlocks blocksFromColumns(const ChunkColumns& columns);
+
+// The chunk holding world block p, for chunks of extent blocks
+glm::ivec2 chunkOfBlock(const glm::ivec3& p, int extent);
+
+#endif
@@ -0,0 +1,87 @@
+#include "chunkcolumns.h"
+#include <algorithm>
+#include <random>
+#include "chunkblocks.h"
+
+std::vector<float> columnSeeds(uint32_t texSeed, int count)
+{
+    std::mt19937 gen(texSeed);
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    std::vector<float> output;
+    output.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        output.push_back(dis(gen));
+    }
+    return output;
+}
+
+size_t ChunkColumns::blockCount() const
+{
+    size_t blocks = this->top.size();
+    for (uint8_t d : this->depth) {
+        blocks += d;
+    }
+    return blocks;
+}
+
+Aabb ChunkColumns::bounds() const
+{
+    int lo = 0, hi = 0;
+    for (size_t c = 0; c < this->top.size(); c++) {
+        int bottom = this->top[c] - this->depth[c];
+        lo = c == 0 ? bottom : std::min(lo, bottom);
+        hi = c == 0 ? this->top[c] : std::max(hi, (int)this->top[c]);
+    }
+    // Cube k covers k..k+1 on every axis
+    Aabb box;
+    box.min = glm::vec3(this->origin.x, lo, this->origin.y);
+    box.max = glm::vec3(this->origin.x + this->extent, hi + 1,
+                        this->origin.y + this->extent);
+    return box;
+}
+
+size_t ChunkColumns::bytes() const
+{
+    return sizeof(*this) + this->top.capacity() * sizeof(int16_t) +
+           this->depth.capacity() * sizeof(uint8_t);
+}
+
+void ChunkColumns::appendOffsets(std::vector<glm::vec3>& offsets) const
+{
+    int n = this->extent;
+    offsets.reserve(offsets.size() + this->blockCount());
+    for (int c = 0; c < n * n; c++) {
+        offsets.emplace_back(this->origin.x + c % n, this->top[c],
+                             this->origin.y + c / n);
+    }
+    for (int c = 0; c < n * n; c++) {
+        for (int k = 1; k <= this->depth[c]; k++) {
+            offsets.emplace_back(this->origin.x + c % n, this->top[c] - k,
+                                 this->origin.y + c / n);
+        }
+    }
+}
+
+void ChunkColumns::appendInstances(std::vector<glm::vec4>& instances,
+                                   float fillerSeed) const
+{
+    int n = this->extent;
+    std::vector<float> seeds = columnSeeds(this->texSeed, n * n);
+    instances.reserve(instances.size() + this->blockCount());
+    for (int c = 0; c < n * n; c++) {
+        int y = this->top[c];
+        instances.emplace_back(this->origin.x + c % n, y,
+                               this->origin.y + c / n,
+                               blockAttribute(blockMaterial(y), seeds[c]));
+    }
+    for (int c = 0; c < n * n; c++) {
+        for (int k = 1; k <= this->depth[c]; k++) {
+            int y = this->top[c] - k;
+            instances.emplace_back(this->origin.x + c % n, y,
+                                   this->origin.y + c / n,
+                                   blockAttribute(blockMaterial(y),
+                                                  fillerSeed));
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef CHUNKCOLUMNS_H
+#define CHUNKCOLUMNS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "frustum.h"
+
+/* One chunk of terrain as a height field. Column c (single-index convention)
+   is a surface block at height top[c] with depth[c] filler blocks stacked
+   directly below it, so a column costs three bytes where its expanded cubes
+   cost 16 (offset and seed) each. This is what the renderer keeps resident;
+   cube offsets, instances and meshes are expanded from it when needed. */
+struct ChunkColumns {
+    glm::ivec2 origin;        // World (x, z) of column 0
+    int extent = 0;           // Columns along each edge
+    uint32_t texSeed = 0;     // Generates the per-column texture seeds
+    std::vector<int16_t> top; // Height of each column's surface block
+    std::vector<uint8_t> depth;
+
+    glm::ivec2 coords() const { return origin / extent; }
+    size_t blockCount() const;
+    // The box around every block, from the bottom of the lowest filler to
+    // the top of the highest surface block
+    Aabb bounds() const;
+    // Heap and inline bytes held by this chunk
+    size_t bytes() const;
+
+    // Appends one offset per block: every surface block in column order,
+    // then each column's fillers from the top down
+    void appendOffsets(std::vector<glm::vec3>& offsets) const;
+    // The same blocks as (offset, blockAttribute()); fillers get fillerSeed
+    // as their texture seed
+    void appendInstances(std::vector<glm::vec4>& instances,
+                         float fillerSeed) const;
+};
+
+// Texture seeds in [0,1) of the count columns of a chunk
+std::vector<float> columnSeeds(uint32_t texSeed, int count);
+
+#endif
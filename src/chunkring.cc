@@ -0,0 +1,292 @@
+#include "chunkring.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+int floorMod(int a, int n)
+{
+    int m = a % n;
+    return m < 0 ? m + n : m;
+}
+}
+
+ChunkRing::ChunkRing(int radius)
+    : radius(std::max(radius, 0)), side(2 * this->radius + 1),
+      center(0, 0), slots(side * side)
+{
+}
+
+int ChunkRing::slotIndex(glm::ivec2 chunkCoords) const
+{
+    return floorMod(chunkCoords.x, this->side) +
+           this->side * floorMod(chunkCoords.y, this->side);
+}
+
+bool ChunkRing::inView(glm::ivec2 chunkCoords) const
+{
+    glm::ivec2 d = chunkCoords - this->center;
+    return this->centered && std::abs(d.x) <= this->radius &&
+           std::abs(d.y) <= this->radius;
+}
+
+bool ChunkRing::holds(glm::ivec2 chunkCoords) const
+{
+    const Slot& slot = this->slots[this->slotIndex(chunkCoords)];
+    return slot.filled && slot.coords == chunkCoords;
+}
+
+std::vector<glm::ivec2> ChunkRing::recenter(glm::ivec2 center)
+{
+    this->center = center;
+    this->centered = true;
+
+    std::vector<glm::ivec2> missing;
+    for (int j = -this->radius; j <= this->radius; j++) {
+        for (int i = -this->radius; i <= this->radius; i++) {
+            glm::ivec2 c = center + glm::ivec2(i, j);
+            const Slot& slot = this->slots[this->slotIndex(c)];
+            if (!slot.filled || slot.coords != c) {
+                missing.push_back(c);
+            }
+        }
+    }
+    std::sort(missing.begin(), missing.end(),
+              [center](const glm::ivec2& a, const glm::ivec2& b) {
+                  glm::ivec2 da = a - center, db = b - center;
+                  return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+              });
+    return missing;
+}
+
+int ChunkRing::store(ChunkData& chunk)
+{
+    if (!this->inView(chunk.coords)) {
+        return -1;
+    }
+    int index = this->slotIndex(chunk.coords);
+    Slot& slot = this->slots[index];
+    if (slot.filled && slot.coords == chunk.coords &&
+        slot.lodStep == chunk.lodStep) {
+        return -1; // Requested twice; chunks never change once generated
+    }
+    slot.filled = true;
+    slot.coords = chunk.coords;
+    slot.columns = std::move(chunk.columns);
+    slot.blockTypes = std::move(chunk.blocks);
+    slot.blocks = slot.columns.blockCount();
+    if (this->chunkExtent == 0 && !slot.blockTypes.empty()) {
+        this->chunkExtent = slot.blockTypes.getExtent();
+    }
+    slot.lodStep = chunk.lodStep;
+    slot.bounds = chunk.lodStep > 1 ? chunk.mesh.bounds()
+                                    : slot.columns.bounds();
+    slot.meshVertices = chunk.mesh.vertices.size();
+    slot.meshFaces = chunk.mesh.faces.size();
+    slot.edited = false;
+    // Its mesh was built against its neighbors as generated
+    for (glm::ivec2 d : {glm::ivec2(1, 0), glm::ivec2(-1, 0),
+                         glm::ivec2(0, 1), glm::ivec2(0, -1)}) {
+        Slot* neighbor = this->blockSlot(chunk.coords + d);
+        if (neighbor != nullptr && neighbor->edited) {
+            this->markDirty(chunk.coords);
+            break;
+        }
+    }
+    return index;
+}
+
+size_t ChunkRing::residentBytes() const
+{
+    size_t bytes = 0;
+    for (const Slot& slot : this->slots) {
+        bytes += slot.columns.bytes();
+    }
+    return bytes;
+}
+
+size_t ChunkRing::blockBytes() const
+{
+    size_t bytes = 0;
+    for (const Slot& slot : this->slots) {
+        bytes += slot.blockTypes.bytes();
+    }
+    return bytes;
+}
+
+uint8_t ChunkRing::blockAt(const glm::ivec3& p) const
+{
+    if (this->chunkExtent == 0) {
+        return kAir;
+    }
+    const ChunkBlocks* blocks =
+            this->chunkBlocks(chunkOfBlock(p, this->chunkExtent));
+    return blocks == nullptr ? kAir : blocks->get(p);
+}
+
+const ChunkBlocks* ChunkRing::chunkBlocks(glm::ivec2 c) const
+{
+    const Slot& slot = this->slots[this->slotIndex(c)];
+    if (!slot.filled || slot.coords != c || slot.blockTypes.empty()) {
+        return nullptr;
+    }
+    return &slot.blockTypes;
+}
+
+ChunkRing::Slot* ChunkRing::blockSlot(glm::ivec2 c)
+{
+    Slot& slot = this->slots[this->slotIndex(c)];
+    if (!slot.filled || slot.coords != c || slot.blockTypes.empty()) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+void ChunkRing::markDirty(glm::ivec2 c)
+{
+    Slot* slot = this->blockSlot(c);
+    if (slot != nullptr && !slot->dirty) {
+        slot->dirty = true;
+        this->dirtySlots.push_back(this->slotIndex(c));
+    }
+}
+
+bool ChunkRing::setBlock(const glm::ivec3& p, uint8_t block)
+{
+    if (this->chunkExtent == 0) {
+        return false;
+    }
+    glm::ivec2 c = chunkOfBlock(p, this->chunkExtent);
+    Slot* slot = this->blockSlot(c);
+    if (slot == nullptr || slot->blockTypes.get(p) == block ||
+        !slot->blockTypes.set(p, block)) {
+        return false;
+    }
+    slot->edited = true;
+    this->markDirty(c);
+    glm::ivec3 local = p - slot->blockTypes.getOrigin();
+    int last = this->chunkExtent - 1;
+    if (local.x == 0) {
+        this->markDirty(c + glm::ivec2(-1, 0));
+    } else if (local.x == last) {
+        this->markDirty(c + glm::ivec2(1, 0));
+    }
+    if (local.z == 0) {
+        this->markDirty(c + glm::ivec2(0, -1));
+    } else if (local.z == last) {
+        this->markDirty(c + glm::ivec2(0, 1));
+    }
+    return true;
+}
+
+std::vector<int> ChunkRing::takeDirty()
+{
+    std::vector<int> dirty;
+    dirty.swap(this->dirtySlots);
+    for (int s : dirty) {
+        this->slots[s].dirty = false;
+    }
+    return dirty;
+}
+
+ChunkVolume ChunkRing::volumeOf(int index) const
+{
+    const ChunkBlocks& blocks = this->slots[index].blockTypes;
+    int n = blocks.getExtent(), edge = n + 2;
+    glm::ivec3 origin = blocks.getOrigin() - glm::ivec3(1, 0, 1);
+    // Meshing cost grows with the volume's height, so it only spans the
+    // layers that hold blocks rather than every section
+    std::vector<uint8_t> dense(edge * edge * blocks.getHeight(), kAir);
+    int lo = blocks.getHeight(), hi = -1;
+    glm::ivec3 l;
+    for (l.y = 0; l.y < blocks.getHeight(); l.y++) {
+        for (l.z = 0; l.z < edge; l.z++) {
+            for (l.x = 0; l.x < edge; l.x++) {
+                bool apron = l.x == 0 || l.z == 0 || l.x == n + 1 ||
+                             l.z == n + 1;
+                uint8_t block = apron ? this->blockAt(origin + l)
+                                      : blocks.get(origin + l);
+                if (block != kAir) {
+                    dense[l.x + edge * (l.z + edge * l.y)] = block;
+                    lo = std::min(lo, l.y);
+                    hi = std::max(hi, l.y);
+                }
+            }
+        }
+    }
+    if (hi < 0) {
+        return ChunkVolume(origin, glm::ivec3(edge, 0, edge));
+    }
+    ChunkVolume volume(origin + glm::ivec3(0, lo, 0),
+                       glm::ivec3(edge, hi - lo + 1, edge));
+    for (l.y = lo; l.y <= hi; l.y++) {
+        for (l.z = 0; l.z < edge; l.z++) {
+            for (l.x = 0; l.x < edge; l.x++) {
+                uint8_t block = dense[l.x + edge * (l.z + edge * l.y)];
+                if (block != kAir) {
+                    volume.set(glm::ivec3(l.x, l.y - lo, l.z), block);
+                }
+            }
+        }
+    }
+    return volume;
+}
+
+ChunkMesh ChunkRing::remesh(int index)
+{
+    Slot& slot = this->slots[index];
+    int n = slot.columns.extent;
+    ChunkMesh mesh = greedyMesh(this->volumeOf(index),
+                                columnSeeds(slot.columns.texSeed, n * n));
+    slot.meshVertices = mesh.vertices.size();
+    slot.meshFaces = mesh.faces.size();
+    slot.bounds = slot.blockTypes.bounds();
+    return mesh;
+}
+
+std::vector<glm::vec4> ChunkRing::reinstance(int index, float fillerSeed)
+{
+    Slot& slot = this->slots[index];
+    int n = slot.columns.extent;
+    std::vector<glm::vec4> instances;
+    slot.blockTypes.appendInstances(
+            instances, columnSeeds(slot.columns.texSeed, n * n), fillerSeed);
+    slot.blocks = instances.size();
+    slot.bounds = slot.blockTypes.bounds();
+    return instances;
+}
+
+int ChunkRing::cull(const Frustum& frustum, std::vector<int>& visible) const
+{
+    visible.clear();
+    int culled = 0;
+    for (int s = 0; s < this->slotCount(); s++) {
+        const Slot& slot = this->slots[s];
+        if (!slot.filled) {
+            continue;
+        }
+        if (frustum.intersects(slot.bounds)) {
+            visible.push_back(s);
+        } else {
+            culled++;
+        }
+    }
+    return culled;
+}
+
+std::vector<glm::vec3> ChunkRing::offsetsNear(glm::ivec2 c, int r) const
+{
+    std::vector<glm::vec3> offsets;
+    for (int j = -r; j <= r; j++) {
+        for (int i = -r; i <= r; i++) {
+            glm::ivec2 n = c + glm::ivec2(i, j);
+            const Slot& slot = this->slots[this->slotIndex(n)];
+            if (slot.filled && slot.coords == n && slot.edited) {
+                slot.blockTypes.appendOffsets(offsets);
+            } else if (slot.filled && slot.coords == n) {
+                slot.columns.appendOffsets(offsets);
+            }
+        }
+    }
+    return offsets;
+}
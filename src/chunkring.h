@@ -0,0 +1,147 @@
+#ifndef CHUNKRING_H
+#define CHUNKRING_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "Terrain.h"
+
+/* The chunks in view, kept in a toroidal grid of (2r+1)^2 slots.
+
+   Chunk c lives in slot (c.x mod side, c.y mod side), so when the view
+   center moves by one chunk only the slots of the row or column that came
+   into view change owner; every other chunk stays where it is. The renderer
+   mirrors the slots in its instance buffer and re-uploads only the slots
+   whose contents changed. Slots hold the chunks' columns and blocks;
+   instances and meshes live on the GPU once uploaded.
+
+   A slot keeps its old chunk until the new one is stored, so a slot never
+   goes blank while its replacement is being generated.
+
+   Once loaded, a chunk's blocks are the truth: setBlock() edits them and
+   marks the chunk dirty, along with any neighbor whose mesh apron the
+   block is in. However many edits land between two takeDirty() calls,
+   each dirty chunk is returned once, so its render data is rebuilt once.
+   Edits live as long as the chunk stays resident. */
+class ChunkRing {
+    public:
+    struct Slot {
+        bool filled = false;
+        glm::ivec2 coords;
+        ChunkColumns columns;
+        ChunkBlocks blockTypes;  // The same blocks, by position
+        size_t blocks = 0;       // columns.blockCount()
+        Aabb bounds;             // Of the columns, or of a LOD mesh
+        int lodStep = 1;
+        size_t meshVertices = 0; // Size of the mesh stored with the chunk
+        size_t meshFaces = 0;
+        bool edited = false;     // blockTypes no longer match columns
+        bool dirty = false;      // Edited since its render data was built
+    };
+
+    private:
+    int radius;
+    int side;
+    glm::ivec2 center;
+    bool centered = false;
+    int chunkExtent = 0; // Of the first full-detail chunk stored
+    std::vector<Slot> slots;
+    std::vector<int> dirtySlots;
+
+    // The slot holding full-detail chunk c, or nullptr
+    Slot* blockSlot(glm::ivec2 c);
+    void markDirty(glm::ivec2 c);
+
+    public:
+    explicit ChunkRing(int radius);
+
+    int getRadius() const { return radius; }
+    int slotCount() const { return side * side; }
+    int slotIndex(glm::ivec2 chunkCoords) const;
+    const Slot& getSlot(int index) const { return slots[index]; }
+
+    // Moves the view and returns the chunks in it that no slot holds yet,
+    // nearest to the center first
+    std::vector<glm::ivec2> recenter(glm::ivec2 center);
+    bool inView(glm::ivec2 chunkCoords) const;
+    // Whether a slot holds the chunk, in view or not
+    bool holds(glm::ivec2 chunkCoords) const;
+
+    // Moves the chunk's columns into its slot and returns the slot index, or
+    // -1 if the view has moved on or the slot already holds this chunk at
+    // this level of detail. The mesh stays with chunk for the caller to
+    // upload.
+    int store(ChunkData& chunk);
+    // Bytes of column data held by all slots
+    size_t residentBytes() const;
+    // Bytes of block sections held by all slots
+    size_t blockBytes() const;
+    // The block at world position p, or air if its chunk is not resident
+    uint8_t blockAt(const glm::ivec3& p) const;
+    // The blocks of full-detail chunk c, or nullptr if it is not resident
+    const ChunkBlocks* chunkBlocks(glm::ivec2 c) const;
+    // Zero until the first full-detail chunk is stored
+    int getChunkExtent() const { return chunkExtent; }
+
+    // Sets the block at world position p and marks its chunk dirty, and the
+    // neighbors across any chunk edge p is on. Returns false if the chunk
+    // is not resident or the block is already of that type.
+    bool setBlock(const glm::ivec3& p, uint8_t block);
+    // The slots marked dirty since the last call, each once, and clears them
+    std::vector<int> takeDirty();
+    // A slot's blocks with a one-block apron of its neighbors'; the apron
+    // is air where a neighbor is not resident
+    ChunkVolume volumeOf(int index) const;
+    // Rebuild a slot's mesh or cube instances from its blocks, updating the
+    // slot's counts and bounds to match
+    ChunkMesh remesh(int index);
+    std::vector<glm::vec4> reinstance(int index, float fillerSeed);
+
+    // Sets visible to the filled slots whose chunk intersects the frustum,
+    // in slot order, and returns how many filled slots were culled
+    int cull(const Frustum& frustum, std::vector<int>& visible) const;
+
+    // Offsets of the resident chunks within r chunks of c, for collision
+    std::vector<glm::vec3> offsetsNear(glm::ivec2 c, int r) const;
+};
+
+/* Block lookups through a ring for walks that stay in one chunk for many
+   blocks at a time (a ray, a body and the blocks around it): the chunk is
+   only looked up again when a block falls outside the last one. Chunks
+   that are not resident are air. */
+class ChunkCursor {
+    const ChunkRing& ring;
+    int extent;
+    glm::ivec2 coords;
+    const ChunkBlocks* blocks = nullptr;
+    bool valid = false;
+
+    public:
+    explicit ChunkCursor(const ChunkRing& ring)
+        : ring(ring), extent(ring.getChunkExtent())
+    {
+    }
+
+    // The blocks of the chunk holding p, or nullptr if it is not resident
+    const ChunkBlocks* blocksAt(const glm::ivec3& p)
+    {
+        if (this->extent == 0) {
+            return nullptr;
+        }
+        glm::ivec2 c = chunkOfBlock(p, this->extent);
+        if (!this->valid || c != this->coords) {
+            this->coords = c;
+            this->blocks = this->ring.chunkBlocks(c);
+            this->valid = true;
+        }
+        return this->blocks;
+    }
+
+    uint8_t get(const glm::ivec3& p)
+    {
+        const ChunkBlocks* blocks = this->blocksAt(p);
+        return blocks == nullptr ? kAir : blocks->get(p);
+    }
+};
+
+#endif
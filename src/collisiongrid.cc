@@ -0,0 +1,53 @@
+#include "collisiongrid.h"
+#include <algorithm>
+#include <limits>
+
+void CollisionGrid::build(const std::vector<glm::vec3>& input)
+{
+    this->cubes.clear();
+    this->cellStart.clear();
+    if (input.empty()) {
+        this->size = glm::ivec2(0, 0);
+        return;
+    }
+
+    glm::ivec2 lo(std::numeric_limits<int>::max());
+    glm::ivec2 hi(std::numeric_limits<int>::min());
+    for (const auto& c : input) {
+        glm::ivec2 col((int)std::floor(c.x), (int)std::floor(c.z));
+        lo = glm::min(lo, col);
+        hi = glm::max(hi, col);
+    }
+    this->origin = lo;
+    this->size = hi - lo + glm::ivec2(1, 1);
+
+    // Counting sort by cell: count, prefix-sum, then scatter
+    std::vector<int> cellOf;
+    cellOf.reserve(input.size());
+    this->cellStart.assign(this->size.x * this->size.y + 1, 0);
+    for (const auto& c : input) {
+        int cell = cellIndex((int)std::floor(c.x), (int)std::floor(c.z));
+        cellOf.push_back(cell);
+        this->cellStart[cell + 1]++;
+    }
+    for (size_t i = 1; i < this->cellStart.size(); i++) {
+        this->cellStart[i] += this->cellStart[i - 1];
+    }
+
+    this->cubes.resize(this->cellStart.back());
+    std::vector<int> cursor(this->cellStart.begin(), this->cellStart.end() - 1);
+    for (size_t i = 0; i < input.size(); i++) {
+        this->cubes[cursor[cellOf[i]]++] = input[i];
+    }
+}
+
+bool CollisionGrid::anyWithin(const glm::vec3& p, float r) const
+{
+    bool found = false;
+    forEachNear(p, r, [&](const glm::vec3& c) {
+        if (!found && glm::length(c - p) < r) {
+            found = true;
+        }
+    });
+    return found;
+}
@@ -0,0 +1,60 @@
+#ifndef COLLISIONGRID_H
+#define COLLISIONGRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/* Broad-phase lookup for the unit cubes the camera collides with.
+
+   Cubes are bucketed by the integer (x,z) column of their min corner into a
+   dense grid covering the bounding box of the view, stored CSR-style: the
+   cubes of cell c are cubes[cellStart[c] .. cellStart[c + 1]). Building is
+   O(n) and happens once per view; a query only visits the cells overlapped
+   by the query square, so its cost does not depend on the view size. */
+class CollisionGrid {
+    glm::ivec2 origin = glm::ivec2(0, 0); // Column of cell (0,0)
+    glm::ivec2 size = glm::ivec2(0, 0);   // Number of columns in x and z
+    std::vector<int> cellStart;
+    std::vector<glm::vec3> cubes;
+
+    int cellIndex(int x, int z) const
+    {
+        return (x - origin.x) + (z - origin.y) * size.x;
+    }
+
+    public:
+    void build(const std::vector<glm::vec3>& cubes);
+
+    /* Calls f(cube) for every cube whose min corner lies in the square
+       [p.x - r, p.x + r] x [p.z - r, p.z + r]. That is a superset of the
+       cubes within distance r of p, so callers apply their exact test. */
+    template <typename F>
+    void forEachNear(const glm::vec3& p, float r, F f) const
+    {
+        if (cubes.empty()) {
+            return;
+        }
+        int x0 = std::max((int)std::floor(p.x - r), origin.x);
+        int x1 = std::min((int)std::floor(p.x + r), origin.x + size.x - 1);
+        int z0 = std::max((int)std::floor(p.z - r), origin.y);
+        int z1 = std::min((int)std::floor(p.z + r), origin.y + size.y - 1);
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                int c = cellIndex(x, z);
+                for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+                    f(cubes[k]);
+                }
+            }
+        }
+    }
+
+    // True if any cube's min corner is strictly closer than r to p
+    bool anyWithin(const glm::vec3& p, float r) const;
+
+    size_t cubeCount() const { return cubes.size(); }
+};
+
+#endif
@@ -11,29 +11,51 @@ std::ostream& operator<<(std::ostream& os, const glm::vec3 x)
 
 namespace CubeData{
 
+// Every face has its own four corners, so each vertex can carry its face's
+// normal and no geometry shader is needed to compute it.
 const std::vector<glm::vec4> baseVerts = {
-        glm::vec4(0.0, 0.0, 0.0, 1.0), glm::vec4(1.0, 0.0, 0.0, 1.0),
-        glm::vec4(0.0, 1.0, 0.0, 1.0), glm::vec4(0.0, 0.0, 1.0, 1.0),
-        glm::vec4(1.0, 1.0, 0.0, 1.0), glm::vec4(0.0, 1.0, 1.0, 1.0),
-        glm::vec4(1.0, 0.0, 1.0, 1.0), glm::vec4(1.0, 1.0, 1.0, 1.0)};
+        // +Z
+        glm::vec4(0.0, 0.0, 1.0, 1.0), glm::vec4(1.0, 0.0, 1.0, 1.0),
+        glm::vec4(0.0, 1.0, 1.0, 1.0), glm::vec4(1.0, 1.0, 1.0, 1.0),
+        // -Z
+        glm::vec4(0.0, 0.0, 0.0, 1.0), glm::vec4(0.0, 1.0, 0.0, 1.0),
+        glm::vec4(1.0, 0.0, 0.0, 1.0), glm::vec4(1.0, 1.0, 0.0, 1.0),
+        // +Y
+        glm::vec4(1.0, 1.0, 0.0, 1.0), glm::vec4(0.0, 1.0, 0.0, 1.0),
+        glm::vec4(1.0, 1.0, 1.0, 1.0), glm::vec4(0.0, 1.0, 1.0, 1.0),
+        // -Y
+        glm::vec4(1.0, 0.0, 0.0, 1.0), glm::vec4(0.0, 0.0, 1.0, 1.0),
+        glm::vec4(0.0, 0.0, 0.0, 1.0), glm::vec4(1.0, 0.0, 1.0, 1.0),
+        // +X
+        glm::vec4(1.0, 0.0, 0.0, 1.0), glm::vec4(1.0, 1.0, 0.0, 1.0),
+        glm::vec4(1.0, 0.0, 1.0, 1.0), glm::vec4(1.0, 1.0, 1.0, 1.0),
+        // -X
+        glm::vec4(0.0, 1.0, 0.0, 1.0), glm::vec4(0.0, 0.0, 0.0, 1.0),
+        glm::vec4(0.0, 1.0, 1.0, 1.0), glm::vec4(0.0, 0.0, 1.0, 1.0),
+};
 
-const std::vector<glm::uvec3> baseFaces = {glm::uvec3(3, 6, 5) // +Z face
-                                           ,
-                                           glm::uvec3(7, 5, 6),
-                                           glm::uvec3(0, 2, 1) // -Z face
-                                           ,
-                                           glm::uvec3(2, 4, 1),
-                                           glm::uvec3(4, 2, 7) // +Y face
-                                           ,
-                                           glm::uvec3(5, 7, 2),
-                                           glm::uvec3(1, 3, 0) // -Y face
-                                           ,
-                                           glm::uvec3(1, 6, 3),
-                                           glm::uvec3(1, 4, 6) // +X face
-                                           ,
-                                           glm::uvec3(4, 7, 6),
-                                           glm::uvec3(2, 0, 5) // -X face
-                                           ,
-                                           glm::uvec3(0, 3, 5)};
+const std::vector<glm::vec3> baseNormals = {
+        glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, 0.0, 1.0),
+        glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, 0.0, 1.0),
+        glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, 0.0, -1.0),
+        glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, 0.0, -1.0),
+        glm::vec3(0.0, 1.0, 0.0), glm::vec3(0.0, 1.0, 0.0),
+        glm::vec3(0.0, 1.0, 0.0), glm::vec3(0.0, 1.0, 0.0),
+        glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, -1.0, 0.0),
+        glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, -1.0, 0.0),
+        glm::vec3(1.0, 0.0, 0.0), glm::vec3(1.0, 0.0, 0.0),
+        glm::vec3(1.0, 0.0, 0.0), glm::vec3(1.0, 0.0, 0.0),
+        glm::vec3(-1.0, 0.0, 0.0), glm::vec3(-1.0, 0.0, 0.0),
+        glm::vec3(-1.0, 0.0, 0.0), glm::vec3(-1.0, 0.0, 0.0),
+};
+
+const std::vector<glm::uvec3> baseFaces = {
+        glm::uvec3(0, 1, 2), glm::uvec3(3, 2, 1), // +Z
+        glm::uvec3(4, 5, 6), glm::uvec3(5, 7, 6), // -Z
+        glm::uvec3(8, 9, 10), glm::uvec3(11, 10, 9), // +Y
+        glm::uvec3(12, 13, 14), glm::uvec3(12, 15, 13), // -Y
+        glm::uvec3(16, 17, 18), glm::uvec3(17, 19, 18), // +X
+        glm::uvec3(20, 21, 22), glm::uvec3(21, 23, 22), // -X
+};
 
 }
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "entities.h"
+#include <algorithm>
+#include <cmath>
+
+#include "bodyphysics.h"
+
+constexpr int EntitySystem::kMaxBatch;
+
+namespace {
+Aabb entityBody(const glm::vec3& p, float halfX, float height, float halfZ)
+{
+    return Aabb{glm::vec3(p.x - halfX, p.y, p.z - halfZ),
+                glm::vec3(p.x + halfX, p.y + height, p.z + halfZ)};
+}
+
+// Puts a's elements in order: element k is the one at old index order[k]
+template <typename T>
+void permute(std::vector<T>& a, const std::vector<int>& order,
+             std::vector<T>& scratch)
+{
+    scratch.resize(a.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        scratch[k] = a[order[k]];
+    }
+    a.swap(scratch);
+}
+}
+
+EntitySystem::EntitySystem(int nThreads)
+{
+    for (int t = 1; t < nThreads; t++) {
+        this->threads.emplace_back(&EntitySystem::run, this);
+    }
+}
+
+EntitySystem::~EntitySystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->started.notify_all();
+    for (std::thread& t : this->threads) {
+        t.join();
+    }
+}
+
+uint32_t EntitySystem::spawn(const glm::vec3& position, const glm::vec3& size,
+                             const glm::vec3& velocity)
+{
+    this->px.push_back(position.x);
+    this->py.push_back(position.y);
+    this->pz.push_back(position.z);
+    this->vx.push_back(velocity.x);
+    this->vy.push_back(velocity.y);
+    this->vz.push_back(velocity.z);
+    this->halfX.push_back(size.x / 2);
+    this->height.push_back(size.y);
+    this->halfZ.push_back(size.z / 2);
+    this->ids.push_back(this->nextId);
+    return this->nextId++;
+}
+
+void EntitySystem::remove(int i)
+{
+    for (std::vector<float>* a : this->floatArrays()) {
+        (*a)[i] = a->back();
+        a->pop_back();
+    }
+    this->ids[i] = this->ids.back();
+    this->ids.pop_back();
+}
+
+void EntitySystem::clear()
+{
+    for (std::vector<float>* a : this->floatArrays()) {
+        a->clear();
+    }
+    this->ids.clear();
+}
+
+std::array<std::vector<float>*, 9> EntitySystem::floatArrays()
+{
+    return {{&this->px, &this->py, &this->pz, &this->vx, &this->vy,
+             &this->vz, &this->halfX, &this->height, &this->halfZ}};
+}
+
+void EntitySystem::setVelocity(int i, const glm::vec3& v)
+{
+    this->vx[i] = v.x;
+    this->vy[i] = v.y;
+    this->vz[i] = v.z;
+}
+
+Aabb EntitySystem::bounds(int i) const
+{
+    return entityBody(this->getPosition(i), this->halfX[i], this->height[i],
+                      this->halfZ[i]);
+}
+
+void EntitySystem::sortByChunk(const ChunkRing& ring)
+{
+    int n = this->size();
+    int extent = ring.getChunkExtent();
+    int sleeping = ring.slotCount(); // The key of entities left asleep
+    this->slotOf.resize(n);
+    std::vector<int> count(sleeping + 2, 0);
+    bool sorted = true;
+    glm::ivec2 last;
+    int lastKey = -1; // Sorted, neighbors are mostly in the same chunk
+    for (int i = 0; i < n; i++) {
+        int key = sleeping;
+        if (extent > 0) {
+            glm::ivec2 c = chunkOfBlock(
+                    glm::ivec3(std::floor(this->px[i]), 0,
+                               std::floor(this->pz[i])),
+                    extent);
+            if (lastKey >= 0 && c == last) {
+                key = lastKey;
+            } else if (ring.chunkBlocks(c) != nullptr) {
+                key = ring.slotIndex(c);
+            }
+            last = c;
+            lastKey = key;
+        }
+        sorted = sorted && (i == 0 || key >= this->slotOf[i - 1]);
+        this->slotOf[i] = key;
+        count[key + 1]++;
+    }
+    for (int k = 1; k <= sleeping + 1; k++) {
+        count[k] += count[k - 1];
+    }
+
+    if (!sorted) {
+        // Counting sort: scatter each entity to its slot's run
+        this->order.resize(n);
+        std::vector<int> cursor(count.begin(), count.end() - 1);
+        for (int i = 0; i < n; i++) {
+            this->order[cursor[this->slotOf[i]]++] = i;
+        }
+        std::vector<float> scratch;
+        for (std::vector<float>* a : this->floatArrays()) {
+            permute(*a, this->order, scratch);
+        }
+        std::vector<uint32_t> idScratch;
+        permute(this->ids, this->order, idScratch);
+    }
+
+    // Each chunk's run, in pieces of at most kMaxBatch, largest first
+    this->batches.clear();
+    this->chunks = 0;
+    for (int s = 0; s < sleeping; s++) {
+        int begin = count[s], end = count[s + 1];
+        if (begin == end) {
+            continue;
+        }
+        this->chunks++;
+        int pieces = (end - begin + kMaxBatch - 1) / kMaxBatch;
+        for (int k = 0; k < pieces; k++) {
+            this->batches.push_back(
+                    Batch{begin + (end - begin) * k / pieces,
+                          begin + (end - begin) * (k + 1) / pieces});
+        }
+    }
+    std::stable_sort(this->batches.begin(), this->batches.end(),
+                     [](const Batch& a, const Batch& b) {
+                         return a.end - a.begin > b.end - b.begin;
+                     });
+    this->awake = count[sleeping];
+}
+
+void EntitySystem::update(int begin, int end)
+{
+    // Gravity and drag
+    for (int i = begin; i < end; i++) {
+        glm::vec3 v = accelerate(this->getVelocity(i), this->gravityStep,
+                                 this->drag);
+        this->vx[i] = v.x;
+        this->vy[i] = v.y;
+        this->vz[i] = v.z;
+    }
+
+    // Terrain. A block can only touch the box if it overlaps it in x and
+    // z, and in y reaches within kContactBand of it.
+    ChunkCursor cursor(*this->ring);
+    for (int i = begin; i < end; i++) {
+        glm::vec3 p = this->getPosition(i);
+        glm::vec3 v = this->getVelocity(i);
+        Aabb body = entityBody(p, this->halfX[i], this->height[i],
+                               this->halfZ[i]);
+        glm::ivec3 lo((int)std::floor(body.min.x),
+                      (int)std::floor(body.min.y - 1.0f - kContactBand) + 1,
+                      (int)std::floor(body.min.z));
+        glm::ivec3 hi((int)std::ceil(body.max.x) - 1,
+                      (int)std::ceil(body.max.y + kContactBand) - 1,
+                      (int)std::ceil(body.max.z) - 1);
+        // Mostly the box and the blocks around it are in one chunk, and
+        // that chunk's blocks are read directly
+        const ChunkBlocks* blocks = cursor.blocksAt(lo);
+        bool within = blocks != nullptr &&
+                      blocks->getExtent() > 0 &&
+                      chunkOfBlock(hi, blocks->getExtent()) ==
+                              chunkOfBlock(lo, blocks->getExtent());
+        glm::ivec3 b;
+        for (b.y = lo.y; b.y <= hi.y; b.y++) {
+            for (b.z = lo.z; b.z <= hi.z; b.z++) {
+                for (b.x = lo.x; b.x <= hi.x; b.x++) {
+                    uint8_t block = within ? blocks->get(b) : cursor.get(b);
+                    if (block == kAir) {
+                        continue;
+                    }
+                    glm::vec3 c(b);
+                    CollisionType contact = collideBlock(body, c);
+                    if (contact == NONE) {
+                        continue;
+                    }
+                    float lift = resolveContact(contact, body, c, v);
+                    if (lift != 0.0f) {
+                        p.y += lift;
+                        body = entityBody(p, this->halfX[i], this->height[i],
+                                          this->halfZ[i]);
+                    }
+                }
+            }
+        }
+        this->py[i] = p.y;
+        this->setVelocity(i, v);
+    }
+
+    // Explicit Euler
+    for (int i = begin; i < end; i++) {
+        this->px[i] += this->timestep * this->vx[i];
+        this->py[i] += this->timestep * this->vy[i];
+        this->pz[i] += this->timestep * this->vz[i];
+    }
+}
+
+void EntitySystem::runBatches()
+{
+    int n = this->batches.size();
+    for (int k = this->nextBatch++; k < n; k = this->nextBatch++) {
+        this->update(this->batches[k].begin, this->batches[k].end);
+    }
+}
+
+void EntitySystem::run()
+{
+    long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->started.wait(lock, [&] {
+                return this->stopping || this->generation != seen;
+            });
+            if (this->stopping) {
+                return;
+            }
+            seen = this->generation;
+        }
+        this->runBatches();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (--this->running == 0) {
+                this->finished.notify_one();
+            }
+        }
+    }
+}
+
+void EntitySystem::tick(double timestep, const ChunkRing& ring)
+{
+    this->sortByChunk(ring);
+    this->ring = &ring;
+    this->timestep = timestep;
+    this->gravityStep = (float)timestep * kGravity;
+    this->drag = dragFactor(timestep);
+    this->nextBatch = 0;
+    if (this->threads.empty() || this->batches.size() < 2) {
+        this->runBatches();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->generation++;
+        this->running = this->threads.size();
+    }
+    this->started.notify_all();
+    this->runBatches();
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [&] { return this->running == 0; });
+}
@@ -0,0 +1,119 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "chunkring.h"
+#include "frustum.h"
+
+/* Mobs and items: boxes that fall, slide and land on the terrain by the
+   rules the camera follows (bodyphysics.h).
+
+   Entities are stored as a structure of arrays, one array per field, and a
+   tick makes three passes over them: gravity and drag over the velocities,
+   terrain contacts entity by entity, then the positions moved by the
+   velocities. Only the contact pass looks at blocks.
+
+   Each tick first sorts the arrays by the ring slot of the chunk each
+   entity is in (a counting sort, skipped when no entity changed chunk), so
+   every chunk's entities are one run of each array. The runs are dealt out
+   to the pool's threads, largest first and split at kMaxBatch entities:
+   threads write disjoint runs and mostly read one chunk's blocks. Entities
+   do not collide with each other, so the result does not depend on how
+   many threads run a tick. Entities over chunks that are not resident
+   sleep until their chunk is back.
+
+   An entity's index changes when the arrays are sorted; its id, from
+   spawn(), does not. */
+class EntitySystem {
+    public:
+    // Most entities one thread takes at a time
+    static constexpr int kMaxBatch = 1024;
+
+    private:
+    // Per entity
+    std::vector<float> px, py, pz;            // Center of the box's bottom
+    std::vector<float> vx, vy, vz;            // Blocks/s
+    std::vector<float> halfX, height, halfZ;  // The box around the position
+    std::vector<uint32_t> ids;
+    uint32_t nextId = 0;
+
+    // The tick being run
+    struct Batch {
+        int begin;
+        int end;
+    };
+    std::vector<Batch> batches;
+    std::atomic<int> nextBatch{0};
+    const ChunkRing* ring = nullptr;
+    float timestep = 0.0f;
+    float gravityStep = 0.0f;
+    float drag = 1.0f;
+    int awake = 0;
+    int chunks = 0;
+
+    // Sorting scratch
+    std::vector<int> slotOf;
+    std::vector<int> order;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    long generation = 0; // Ticks handed to the threads
+    int running = 0;     // Threads still on the current tick
+    bool stopping = false;
+
+    std::array<std::vector<float>*, 9> floatArrays();
+    // Sorts the arrays by chunk and sets batches to the awake entities
+    void sortByChunk(const ChunkRing& ring);
+    void runBatches();
+    void update(int begin, int end);
+    void run();
+
+    public:
+    // Ticks run on nThreads threads, the caller's included
+    explicit EntitySystem(int nThreads = 1);
+    ~EntitySystem();
+    EntitySystem(const EntitySystem&) = delete;
+    EntitySystem& operator=(const EntitySystem&) = delete;
+
+    // Adds an entity standing on position, size.x by size.y by size.z
+    // blocks, and returns its id
+    uint32_t spawn(const glm::vec3& position, const glm::vec3& size,
+                   const glm::vec3& velocity = glm::vec3(0.0f));
+    // Removes entity i; the last entity takes its index
+    void remove(int i);
+    void clear();
+
+    // Moves every awake entity on by timestep seconds against the ring's
+    // blocks
+    void tick(double timestep, const ChunkRing& ring);
+
+    int size() const { return px.size(); }
+    uint32_t getId(int i) const { return ids[i]; }
+    glm::vec3 getPosition(int i) const
+    {
+        return glm::vec3(px[i], py[i], pz[i]);
+    }
+    glm::vec3 getVelocity(int i) const
+    {
+        return glm::vec3(vx[i], vy[i], vz[i]);
+    }
+    void setVelocity(int i, const glm::vec3& v);
+    Aabb bounds(int i) const;
+
+    int threadCount() const { return threads.size() + 1; }
+    // Entities moved and chunks they were in, in the last tick
+    int awakeCount() const { return awake; }
+    int chunkCount() const { return chunks; }
+};
+
+#endif
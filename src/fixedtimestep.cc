@@ -0,0 +1,34 @@
+#include "fixedtimestep.h"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(double ticksPerSecond, int maxTicksPerFrame)
+    : tickSeconds(1.0 / ticksPerSecond),
+      maxTicksPerFrame(std::max(maxTicksPerFrame, 1))
+{
+}
+
+int FixedTimestep::advance(double frameSeconds)
+{
+    this->accumulator += std::max(frameSeconds, 0.0);
+    int n = (int)(this->accumulator / this->tickSeconds);
+    if (n > this->maxTicksPerFrame) {
+        this->dropped += n - this->maxTicksPerFrame;
+        this->accumulator -= (n - this->maxTicksPerFrame) * this->tickSeconds;
+        n = this->maxTicksPerFrame;
+    }
+    this->accumulator -= n * this->tickSeconds;
+    this->ticks += n;
+    return n;
+}
+
+float FixedTimestep::alpha() const
+{
+    return (float)std::min(this->accumulator / this->tickSeconds, 1.0);
+}
+
+double FixedTimestep::lateness(int k, int n) const
+{
+    // The last of the n ticks fell due accumulator seconds ago, each one
+    // before it a tick earlier
+    return this->accumulator + (n - 1 - k) * this->tickSeconds;
+}
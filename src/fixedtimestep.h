@@ -0,0 +1,37 @@
+#ifndef FIXEDTIMESTEP_H
+#define FIXEDTIMESTEP_H
+
+/* Fixed-rate simulation ticks driven by variable-rate frames.
+
+   Each frame hands advance() the wall time it took; that time accumulates,
+   and every whole tick of it is run as one simulation step of exactly
+   getTickSeconds(), so the simulation behaves the same at any frame rate
+   or refresh interval. What is left over, less than a tick, is alpha():
+   how far the frame is from the last tick to the next, for interpolating
+   what is drawn. After a stall (a debugger, a slow frame) at most
+   maxTicksPerFrame are run and the rest of the backlog is dropped rather
+   than caught up on. */
+class FixedTimestep {
+    double tickSeconds;
+    int maxTicksPerFrame;
+    double accumulator = 0.0;
+    long ticks = 0;
+    long dropped = 0;
+
+    public:
+    explicit FixedTimestep(double ticksPerSecond, int maxTicksPerFrame = 5);
+
+    // Adds a frame's wall time and returns how many ticks to run now
+    int advance(double frameSeconds);
+    // In [0, 1): the fraction of a tick since the last one
+    float alpha() const;
+    // Seconds tick k (from 0) of those advance() just returned has been due
+    // for when advance() returned
+    double lateness(int k, int n) const;
+
+    double getTickSeconds() const { return tickSeconds; }
+    long tickCount() const { return ticks; }
+    long droppedTicks() const { return dropped; }
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef FRACTALNOISE_H
+#define FRACTALNOISE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "noise.h"
+
+// One octave of FractalNoise: lattice cells per chunk edge, and the weight
+// of its [0,1] Perlin noise in the sum
+struct NoiseOctave {
+    float frequency;
+    float amplitude;
+};
+
+/* Perlin noise summed over a compile-time number of octaves.
+
+   Octave k has a lattice of its own, aligned with the world: its point
+   (x, z) sits frequency / extent lattice cells per block from the origin
+   and gets latticeGradient(seed, k + 1, x, z), so two chunks agree along
+   their shared edge at any frequency, whole or not.
+
+   tile() evaluates a chunk in one pass over its rows: each row gets every
+   octave added in before the next row starts, as one perlinSpan() per
+   lattice cell the row crosses, or one perlinRow() for the whole row once
+   cells are narrower than kMinSpan samples. The lattice coordinates and
+   gradients are set up once per tile. Octaves is a template parameter, so
+   the octave loops have a fixed trip count and unroll. */
+template <int Octaves>
+class FractalNoise {
+    static_assert(Octaves >= 1, "FractalNoise needs at least one octave");
+
+    // Where one axis of a tile falls on an octave's lattice
+    struct Axis {
+        int first;              // Lattice coordinate of the tile's first cell
+        int cells;              // Cells the tile touches
+        std::vector<float> pos; // Per sample, position within its cell
+        std::vector<int> cell;  // Per sample, cell from first
+        std::vector<int> edges; // First sample of each cell, then extent
+    };
+
+    // Below this many samples per cell, spans cost more in calls than
+    // perlinRow() does in gradient loads
+    static constexpr int kMinSpan = 8;
+
+    uint64_t seed;
+    std::array<NoiseOctave, Octaves> octaves;
+
+    static Axis axis(int chunk, int extent, float frequency)
+    {
+        Axis a;
+        a.pos.resize(extent);
+        a.cell.resize(extent);
+        double scale = (double)frequency / extent;
+        double start = (double)chunk * extent * scale;
+        a.first = (int)std::floor(start);
+        start -= a.first;
+        for (int i = 0; i < extent; i++) {
+            double u = start + i * scale; // Never negative
+            int c = (int)u;
+            a.pos[i] = (float)(u - c);
+            a.cell[i] = c;
+            if (i == 0 || c != a.cell[i - 1]) {
+                a.edges.push_back(i);
+            }
+        }
+        a.edges.push_back(extent);
+        a.cells = a.cell[extent - 1] + 1;
+        return a;
+    }
+
+    public:
+    FractalNoise(uint64_t seed, const std::array<NoiseOctave, Octaves>& octaves)
+        : seed(seed), octaves(octaves)
+    {
+    }
+
+    // Octave k has frequency * lacunarity^k and amplitude * gain^k
+    FractalNoise(uint64_t seed, float frequency, float lacunarity, float gain,
+                 float amplitude = 1.0f)
+        : seed(seed)
+    {
+        for (int k = 0; k < Octaves; k++) {
+            this->octaves[k] = NoiseOctave{frequency, amplitude};
+            frequency *= lacunarity;
+            amplitude *= gain;
+        }
+    }
+
+    static constexpr int octaveCount() { return Octaves; }
+    const NoiseOctave& octave(int k) const { return octaves[k]; }
+
+    // Every sample is on [0, maxValue()]
+    float maxValue() const
+    {
+        float sum = 0.0f;
+        for (const NoiseOctave& o : this->octaves) {
+            sum += o.amplitude;
+        }
+        return sum;
+    }
+
+    // Writes the extent x extent samples of the chunk at chunkCoords to out,
+    // in the single-index convention
+    void tile(glm::ivec2 chunkCoords, int extent, float* out) const
+    {
+        Axis xs[Octaves], zs[Octaves];
+        std::vector<glm::vec2> grads[Octaves]; // Per octave, row by row
+        bool spans[Octaves];
+        for (int k = 0; k < Octaves; k++) {
+            float frequency = this->octaves[k].frequency;
+            xs[k] = axis(chunkCoords.x, extent, frequency);
+            zs[k] = axis(chunkCoords.y, extent, frequency);
+            int w = xs[k].cells + 1, h = zs[k].cells + 1;
+            spans[k] = extent >= kMinSpan * xs[k].cells;
+            grads[k].resize(w * h);
+            for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                    grads[k][i + w * j] = latticeGradient(
+                            this->seed, k + 1, xs[k].first + i,
+                            zs[k].first + j);
+                }
+            }
+        }
+
+        std::fill(out, out + extent * extent, 0.0f);
+        for (int j = 0; j < extent; j++) {
+            float* row = out + j * extent;
+            for (int k = 0; k < Octaves; k++) {
+                const Axis& x = xs[k];
+                int w = x.cells + 1;
+                const glm::vec2* g = &grads[k][w * zs[k].cell[j]];
+                float z = zs[k].pos[j];
+                float amplitude = this->octaves[k].amplitude;
+                if (!spans[k]) {
+                    perlinRow(g, g + w, x.cell.data(), z, x.pos.data(), row,
+                              extent, amplitude);
+                    continue;
+                }
+                for (size_t e = 0; e + 1 < x.edges.size(); e++) {
+                    int i = x.edges[e];
+                    int c = x.cell[i];
+                    const glm::vec2 corners[4] = {g[c], g[c + 1], g[c + w],
+                                                  g[c + w + 1]};
+                    perlinSpan(corners, z, &x.pos[i], row + i,
+                               x.edges[e + 1] - i, amplitude);
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // glm is column-major: row i is m[0][i], m[1][i], m[2][i], m[3][i]
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) {
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+    // -w <= x, y, z <= w
+    for (int axis = 0; axis < 3; axis++) {
+        this->planes[2 * axis] = row[3] + row[axis];
+        this->planes[2 * axis + 1] = row[3] - row[axis];
+    }
+}
+
+bool Frustum::intersects(const Aabb& box) const
+{
+    for (const glm::vec4& p : this->planes) {
+        // The corner furthest along the plane's normal
+        glm::vec3 corner(p.x > 0 ? box.max.x : box.min.x,
+                         p.y > 0 ? box.max.y : box.min.y,
+                         p.z > 0 ? box.max.z : box.min.z);
+        if (p.x * corner.x + p.y * corner.y + p.z * corner.z + p.w < 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// Axis-aligned box, in world space
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+/* The six planes of a view volume, taken from the rows of the matrix that
+   maps world space to clip space (projection * view). Nothing here needs a
+   GL context. */
+class Frustum {
+    glm::vec4 planes[6]; // (normal, distance), normals pointing inside
+
+    public:
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // Conservative: false only if the box is entirely outside one plane, so
+    // a few boxes near the corners pass without being visible
+    bool intersects(const Aabb& box) const;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Cache statistics, cumulative since construction (or the last clear())
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;  // Bytes currently charged against the budget
+    size_t budget = 0; // Maximum bytes before eviction kicks in
+};
+
+/* A least-recently-used map with a byte budget. Every entry is charged the
+   number of bytes given at insertion time; when the total exceeds the budget,
+   the least recently used entries are dropped until it fits again. The most
+   recently inserted entry is never evicted, even if it alone exceeds the
+   budget.
+
+   Pointers/references returned by find() and insert() stay valid until that
+   entry is evicted, i.e. until the next insert() or clear(). */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+    struct Entry {
+        Key key;
+        Value value;
+        size_t bytes;
+    };
+    typedef typename std::list<Entry>::iterator EntryIt;
+
+    std::list<Entry> order; // Front is most recently used
+    std::unordered_map<Key, EntryIt, Hash> index;
+    CacheStats stats;
+
+    void evict()
+    {
+        while (stats.bytes > stats.budget && order.size() > 1) {
+            Entry& victim = order.back();
+            stats.bytes -= victim.bytes;
+            stats.evictions++;
+            index.erase(victim.key);
+            order.pop_back();
+        }
+        stats.entries = order.size();
+    }
+
+    public:
+    explicit LruCache(size_t budgetBytes) { stats.budget = budgetBytes; }
+
+    // Returns the cached value and marks it most-recently used, or nullptr
+    const Value* find(const Key& key)
+    {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            stats.misses++;
+            return nullptr;
+        }
+        stats.hits++;
+        order.splice(order.begin(), order, it->second);
+        return &it->second->value;
+    }
+
+    bool contains(const Key& key) const
+    {
+        return index.find(key) != index.end();
+    }
+
+    // Inserts (or replaces) a value, then evicts down to the budget
+    const Value& insert(const Key& key, Value value, size_t bytes)
+    {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            stats.bytes -= it->second->bytes;
+            order.erase(it->second);
+            index.erase(it);
+        }
+        order.push_front(Entry{key, std::move(value), bytes});
+        index[key] = order.begin();
+        stats.bytes += bytes;
+        evict();
+        return order.front().value;
+    }
+
+    void setBudget(size_t budgetBytes)
+    {
+        stats.budget = budgetBytes;
+        evict();
+    }
+
+    void clear()
+    {
+        order.clear();
+        index.clear();
+        size_t budget = stats.budget;
+        stats = CacheStats();
+        stats.budget = budget;
+    }
+
+    size_t size() const { return order.size(); }
+    const CacheStats& getStats() const { return stats; }
+};
+
+#endif
@@ -1,9 +1,12 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -15,22 +18,50 @@
 #include <GLFW/glfw3.h>
 #include <debuggl.h>
 #include "Terrain.h"
+#include "blocktextures.h"
 #include "camera.h"
+#include "chunkring.h"
+#include "collisiongrid.h"
+#include "entities.h"
+#include "fixedtimestep.h"
+#include "frustum.h"
+#include "profiler.h"
+#include "raycast.h"
+#include "terrainworkers.h"
 #include "tictoc.h"
 
 int window_width = 800, window_height = 600;
 
 std::ostream& operator<<(std::ostream& os, const glm::vec4 x);
 
-// VBO and VAO descriptors.
-enum { kVertexBuffer, kIndexBuffer, kNumVbos };
+// VBO and VAO descriptors. Per-instance data (offset and seed) lives in its
+// own buffer so it can be resized without touching the cube geometry.
+// Per-vertex face normals (for shaders without a geometry stage) are kept
+// in a buffer of their own as well.
+enum { kVertexBuffer, kIndexBuffer, kInstanceBuffer, kNormalBuffer, kNumVbos };
 
-// These are our VAOs.
+// These are our VAOs. kCubeVao draws instanced cubes; greedy meshes have
+// MeshSlots of their own.
 enum { kCubeVao, kFloorVao, kNumVaos };
 
 GLuint g_array_objects[kNumVaos]; // This will store the VAO descriptors.
 GLuint g_buffer_objects[kNumVaos]
                        [kNumVbos]; // These will store VBO descriptors.
+size_t g_slot_capacity = 0; // Instances that fit in one chunk slot
+
+// The greedy meshes of one ChunkRing: a VAO and buffers with one fixed-size
+// slot per ring slot
+struct MeshSlots {
+    GLuint vao = 0;
+    GLuint buffers[kNumVbos] = {}; // kInstanceBuffer is unused
+    size_t vertexCapacity = 0;     // Mesh vertices that fit in one slot
+    size_t faceCapacity = 0;       // Mesh triangles that fit in one slot
+};
+MeshSlots g_meshes; // The full-detail view
+size_t g_uploaded_bytes = 0; // Instance or mesh data sent to the GPU so far
+bool g_meshed = true;        // Draw greedy meshes rather than cube instances
+bool g_geometry_shader = false; // Compute face normals in a geometry shader
+bool g_baked_textures = false;  // Sample baked noise instead of computing it
 
 // Include shader program strings
 #include "cubedata.cc"
@@ -43,8 +74,15 @@ std::vector<glm::vec4> floor_vertices = {
         {m, t, m, 1.0}, {-m, t, m, 1.0}, {-m, t, -m, 1.0}, {m, t, -m, 1.0}};
 std::vector<glm::uvec3> floor_faces = {{0, 2, 1}, {3, 2, 0}};
 
-constexpr unsigned int nCubeInstance =
-        32000; // 5x5 chunks, 16x16 each, with spares
+constexpr float kPrefetchLookahead = 2.0f; // Seconds of camera velocity
+const glm::ivec2 kNoChunk(-10000, 100000);
+constexpr float kReach = 8.0f; // Blocks the camera can edit from
+constexpr int kBurstEdge = 10; // X breaks a cube of kBurstEdge^3 blocks
+constexpr double kDefaultTickRate = 60.0; // Simulation ticks per second
+// Entities spawned by --entities: one in kMobEvery is a mob, the rest items
+constexpr int kMobEvery = 4;
+const glm::vec3 kMobSize(0.6f, 1.8f, 0.6f);
+const glm::vec3 kItemSize(0.25f);
 
 void ErrorCallback(int error, const char* description)
 {
@@ -57,6 +95,16 @@ int strafe_cam = 0;
 int roll_cam = 0;
 int lev_cam = 0;
 
+// A block edit asked for from the keyboard, applied on the next frame
+enum EditAction { kNoEdit, kBreakBlock, kPlaceBlock, kBreakBurst };
+EditAction g_edit = kNoEdit;
+TicTocTimer g_edit_requested; // When the pending edit was asked for
+
+// Input waiting to be seen on screen, and when it was read: mouse looks
+// show in the frame that reads them, movement keys once a tick has run
+bool g_look_pending = false, g_move_pending = false;
+TicTocTimer g_look_read, g_move_read;
+
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action,
                  int mods)
 {
@@ -98,6 +146,33 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action,
     } else if (key == GLFW_KEY_C && action != GLFW_RELEASE) {
         // No non-FPS mode here
         ((void)0);
+    } else if (key == GLFW_KEY_G && action == GLFW_RELEASE) {
+        g_geometry_shader = !g_geometry_shader;
+        std::cout << "Face normals from "
+                  << (g_geometry_shader ? "geometry shader" : "vertex data")
+                  << std::endl;
+    } else if (key == GLFW_KEY_T && action == GLFW_RELEASE) {
+        g_baked_textures = !g_baked_textures;
+        std::cout << "Block textures "
+                  << (g_baked_textures ? "baked" : "procedural") << std::endl;
+    } else if ((key == GLFW_KEY_E || key == GLFW_KEY_Q ||
+                key == GLFW_KEY_X) &&
+               action == GLFW_PRESS) {
+        // E breaks the targeted block, Q places one against it, X breaks
+        // a whole cube of blocks around it
+        g_edit = key == GLFW_KEY_E ? kBreakBlock
+                                   : key == GLFW_KEY_Q ? kPlaceBlock
+                                                       : kBreakBurst;
+        g_edit_requested = tic();
+    }
+    bool moves = key == GLFW_KEY_W || key == GLFW_KEY_S ||
+                 key == GLFW_KEY_A || key == GLFW_KEY_D ||
+                 key == GLFW_KEY_UP || key == GLFW_KEY_DOWN ||
+                 key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT ||
+                 key == GLFW_KEY_SPACE;
+    if (moves && action == GLFW_PRESS && !g_move_pending) {
+        g_move_pending = true;
+        g_move_read = tic();
     }
     if (key == GLFW_KEY_0 && action != GLFW_RELEASE) {
     } else if (key == GLFW_KEY_1 && action != GLFW_RELEASE) {
@@ -107,6 +182,424 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action,
     }
 }
 
+/* The cube instance buffer mirrors a ChunkRing: slot s occupies instances
+   [s * g_slot_capacity, (s + 1) * g_slot_capacity), each instance being
+   (offset.xyz, blockAttribute()). A chunk crossing only rewrites the slots
+   of the chunks that came into view. The mesh vertex and index buffers are
+   laid out the same way, with their own per-slot capacities.
+
+   The ring keeps only each chunk's columns and blocks, so the GPU holds the
+   only copy of the expanded data; growing a slot copies the old slots
+   buffer to buffer instead of uploading them again. */
+
+// Give every slot of buffer newStride bytes, keeping the first oldStride
+// bytes of each. The buffer name is kept so the VAOs pointing at it stay
+// valid.
+void GrowSlots(GLuint buffer, size_t oldStride, size_t newStride, int slots)
+{
+    GLuint scratch = 0;
+    if (oldStride > 0) {
+        CHECK_GL_ERROR(glGenBuffers(1, &scratch));
+        CHECK_GL_ERROR(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        CHECK_GL_ERROR(glBindBuffer(GL_COPY_WRITE_BUFFER, scratch));
+        CHECK_GL_ERROR(glBufferData(GL_COPY_WRITE_BUFFER, oldStride * slots,
+                                    nullptr, GL_STREAM_COPY));
+        CHECK_GL_ERROR(glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                                           GL_COPY_WRITE_BUFFER, 0, 0,
+                                           oldStride * slots));
+    }
+    CHECK_GL_ERROR(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+    CHECK_GL_ERROR(glBufferData(GL_COPY_WRITE_BUFFER, newStride * slots,
+                                nullptr, GL_DYNAMIC_DRAW));
+    if (oldStride > 0) {
+        CHECK_GL_ERROR(glBindBuffer(GL_COPY_READ_BUFFER, scratch));
+        for (int s = 0; s < slots; s++) {
+            CHECK_GL_ERROR(glCopyBufferSubData(
+                    GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldStride * s,
+                    newStride * s, oldStride));
+        }
+        CHECK_GL_ERROR(glDeleteBuffers(1, &scratch));
+    }
+}
+
+// Grow the instance buffer to capacity instances per slot
+void AllocateSlots(const ChunkRing& ring, size_t capacity)
+{
+    GrowSlots(g_buffer_objects[kCubeVao][kInstanceBuffer],
+              sizeof(glm::vec4) * g_slot_capacity,
+              sizeof(glm::vec4) * capacity, ring.slotCount());
+    g_slot_capacity = capacity;
+}
+
+// Copy instances into one slot of the instance buffer, growing every slot
+// first if they do not fit
+void UploadSlot(const ChunkRing& ring, int index,
+                const std::vector<glm::vec4>& instances)
+{
+    size_t n = instances.size();
+    if (n > g_slot_capacity) {
+        AllocateSlots(ring, n + n / 4);
+    }
+    size_t bytes = sizeof(glm::vec4) * n;
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                g_buffer_objects[kCubeVao][kInstanceBuffer]));
+    CHECK_GL_ERROR(glBufferSubData(
+            GL_ARRAY_BUFFER, sizeof(glm::vec4) * g_slot_capacity * index,
+            bytes, instances.data()));
+    g_uploaded_bytes += bytes;
+}
+
+// Create the VAO and buffers. Positions have blockAttribute() in w;
+// attribute 0 only reads xyz (w defaults to 1), and attribute 1 is left
+// disabled so the instance offset is constant.
+void CreateMeshSlots(MeshSlots& meshes)
+{
+    CHECK_GL_ERROR(glGenVertexArrays(1, &meshes.vao));
+    CHECK_GL_ERROR(glBindVertexArray(meshes.vao));
+    CHECK_GL_ERROR(glGenBuffers(kNumVbos, meshes.buffers));
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                meshes.buffers[kVertexBuffer]));
+    CHECK_GL_ERROR(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                                         sizeof(glm::vec4), 0));
+    CHECK_GL_ERROR(glEnableVertexAttribArray(0));
+    CHECK_GL_ERROR(glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE,
+                                         sizeof(glm::vec4),
+                                         (void*)(3 * sizeof(float))));
+    CHECK_GL_ERROR(glEnableVertexAttribArray(2));
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                meshes.buffers[kNormalBuffer]));
+    CHECK_GL_ERROR(glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0));
+    CHECK_GL_ERROR(glEnableVertexAttribArray(3));
+    CHECK_GL_ERROR(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                                meshes.buffers[kIndexBuffer]));
+}
+
+// Grow the mesh buffers to the given vertices and triangles per slot
+void AllocateMeshSlots(MeshSlots& meshes, const ChunkRing& ring,
+                       size_t vertices, size_t faces)
+{
+    GrowSlots(meshes.buffers[kVertexBuffer],
+              sizeof(glm::vec4) * meshes.vertexCapacity,
+              sizeof(glm::vec4) * vertices, ring.slotCount());
+    GrowSlots(meshes.buffers[kIndexBuffer],
+              sizeof(glm::uvec3) * meshes.faceCapacity,
+              sizeof(glm::uvec3) * faces, ring.slotCount());
+    GrowSlots(meshes.buffers[kNormalBuffer],
+              sizeof(glm::vec3) * meshes.vertexCapacity,
+              sizeof(glm::vec3) * vertices, ring.slotCount());
+    meshes.vertexCapacity = vertices;
+    meshes.faceCapacity = faces;
+}
+
+// Copy a mesh into one slot of the mesh buffers. The element buffer binding
+// is VAO state, so meshes.vao must be bound.
+void UploadMeshSlot(const MeshSlots& meshes, int index, const ChunkMesh& mesh)
+{
+    size_t vertexBytes = sizeof(glm::vec4) * mesh.vertices.size();
+    size_t normalBytes = sizeof(glm::vec3) * mesh.normals.size();
+    size_t faceBytes = sizeof(glm::uvec3) * mesh.faces.size();
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                meshes.buffers[kVertexBuffer]));
+    CHECK_GL_ERROR(glBufferSubData(
+            GL_ARRAY_BUFFER, sizeof(glm::vec4) * meshes.vertexCapacity * index,
+            vertexBytes, mesh.vertices.data()));
+    CHECK_GL_ERROR(glBufferSubData(
+            GL_ELEMENT_ARRAY_BUFFER,
+            sizeof(glm::uvec3) * meshes.faceCapacity * index, faceBytes,
+            mesh.faces.data()));
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                meshes.buffers[kNormalBuffer]));
+    CHECK_GL_ERROR(glBufferSubData(
+            GL_ARRAY_BUFFER, sizeof(glm::vec3) * meshes.vertexCapacity * index,
+            normalBytes, mesh.normals.data()));
+    g_uploaded_bytes += vertexBytes + normalBytes + faceBytes;
+}
+
+// Upload the mesh of the chunk stored in slot index, growing every slot
+// first if it does not fit
+void UploadMesh(MeshSlots& meshes, const ChunkRing& ring, int index,
+                const ChunkMesh& mesh)
+{
+    CHECK_GL_ERROR(glBindVertexArray(meshes.vao));
+    size_t nv = mesh.vertices.size();
+    size_t nf = mesh.faces.size();
+    if (nv > meshes.vertexCapacity || nf > meshes.faceCapacity) {
+        AllocateMeshSlots(meshes, ring,
+                          std::max(meshes.vertexCapacity, nv + nv / 4),
+                          std::max(meshes.faceCapacity, nf + nf / 4));
+    }
+    UploadMeshSlot(meshes, index, mesh);
+}
+
+// Store a generated chunk in the ring and upload it, growing every slot
+// first if it does not fit. Returns the slot index, or -1 if the chunk was
+// not needed.
+int StreamChunk(ChunkRing& ring, ChunkData& chunk)
+{
+    ScopedTimer timer(kZoneUpload);
+    int index = ring.store(chunk);
+    if (index < 0) {
+        return -1;
+    }
+    if (g_meshed) {
+        UploadMesh(g_meshes, ring, index, chunk.mesh);
+    } else {
+        std::vector<glm::vec4> instances;
+        ring.getSlot(index).columns.appendInstances(instances,
+                                                    Terrain::kFillerSeed);
+        UploadSlot(ring, index, instances);
+    }
+    return index;
+}
+
+// Apply an edit at the block the camera looks at, within reach, and return
+// how many blocks changed. A placed block goes against the face the view
+// ray entered through and takes the type of the block it is placed on.
+int ApplyEdit(ChunkRing& ring, EditAction action, glm::vec3 eye,
+              glm::vec3 look)
+{
+    RayHit target = raycast(ring, Ray{eye, look, kReach});
+    if (!target.hit) {
+        return 0;
+    }
+    if (action == kPlaceBlock) {
+        return target.face != glm::ivec3(0) &&
+               ring.setBlock(target.block + target.face, target.type);
+    }
+    if (action == kBreakBlock) {
+        return ring.setBlock(target.block, kAir);
+    }
+    int changed = 0;
+    glm::ivec3 corner = target.block - glm::ivec3(kBurstEdge / 2);
+    for (int y = 0; y < kBurstEdge; y++) {
+        for (int z = 0; z < kBurstEdge; z++) {
+            for (int x = 0; x < kBurstEdge; x++) {
+                changed += ring.setBlock(corner + glm::ivec3(x, y, z), kAir);
+            }
+        }
+    }
+    return changed;
+}
+
+// Rebuild and re-upload the render data of every chunk edited since the
+// last call, once each, and return how many were rebuilt
+int RebuildDirtyChunks(ChunkRing& ring)
+{
+    std::vector<int> dirty = ring.takeDirty();
+    for (int s : dirty) {
+        if (g_meshed) {
+            UploadMesh(g_meshes, ring, s, ring.remesh(s));
+        } else {
+            UploadSlot(ring, s, ring.reinstance(s, Terrain::kFillerSeed));
+        }
+    }
+    return dirty.size();
+}
+
+// A level of detail beyond the full-detail view: its ring of chunks and
+// their downsampled meshes
+struct LodRing {
+    LodLevel level;
+    ChunkRing ring;
+    MeshSlots meshes;
+
+    explicit LodRing(LodLevel level) : level(level), ring(level.radius) {}
+};
+
+// The same as StreamChunk() for a chunk's LOD mesh
+int StreamLodChunk(LodRing& lod, ChunkData& chunk)
+{
+    ScopedTimer timer(kZoneUpload);
+    int index = lod.ring.store(chunk);
+    if (index >= 0) {
+        UploadMesh(lod.meshes, lod.ring, index, chunk.mesh);
+    }
+    return index;
+}
+
+/* Which ring draws chunk c, given the full-detail ring followed by the LOD
+   rings: the first that holds c, looking from the one whose level c is in
+   now outward, then inward. A chunk that changed level keeps being drawn
+   at its old one until its new mesh arrives, and is never drawn twice.
+   Returns -1 if no ring holds c or c is beyond the outermost ring. */
+int DrawingRing(const std::vector<const ChunkRing*>& rings, glm::ivec2 c)
+{
+    int n = rings.size();
+    int level = -1;
+    for (int k = 0; k < n; k++) {
+        if (rings[k]->inView(c)) {
+            level = k;
+            break;
+        }
+    }
+    if (level < 0) {
+        return -1;
+    }
+    for (int k = level; k < n; k++) {
+        if (rings[k]->holds(c)) {
+            return k;
+        }
+    }
+    for (int k = level - 1; k >= 0; k--) {
+        if (rings[k]->holds(c)) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+// Keep only the slots of rings[k] whose chunk that ring draws
+void KeepDrawnSlots(const std::vector<const ChunkRing*>& rings, int k,
+                    std::vector<int>& slots)
+{
+    const ChunkRing& ring = *rings[k];
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [&](int s) {
+                                   return DrawingRing(
+                                                  rings,
+                                                  ring.getSlot(s).coords) !=
+                                          k;
+                               }),
+                slots.end());
+}
+
+// One instanced draw per resident chunk. Without baseInstance (GL 4.2) the
+// per-instance attributes are re-pointed at each slot instead.
+void DrawSlots(const ChunkRing& ring, const std::vector<int>& visible,
+               size_t nIndices)
+{
+    CHECK_GL_ERROR(glBindVertexArray(g_array_objects[kCubeVao]));
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                g_buffer_objects[kCubeVao][kInstanceBuffer]));
+    for (int s : visible) {
+        const ChunkRing::Slot& slot = ring.getSlot(s);
+        size_t base = sizeof(glm::vec4) * g_slot_capacity * s;
+        CHECK_GL_ERROR(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+                                             sizeof(glm::vec4),
+                                             (void*)base));
+        CHECK_GL_ERROR(glVertexAttribPointer(
+                2, 1, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+                (void*)(base + 3 * sizeof(float))));
+        CHECK_GL_ERROR(glDrawElementsInstanced(GL_TRIANGLES, nIndices,
+                                               GL_UNSIGNED_INT, 0,
+                                               slot.blocks));
+    }
+}
+
+// The visible chunks' meshes in one multi-draw. Mesh vertices are already
+// in world space, so the instance offset (attribute 1) is held at zero.
+void DrawMeshSlots(const MeshSlots& meshes, const ChunkRing& ring,
+                   const std::vector<int>& visible)
+{
+    static std::vector<GLsizei> counts;
+    static std::vector<const void*> indexBases;
+    static std::vector<GLint> baseVertices;
+    counts.clear();
+    indexBases.clear();
+    baseVertices.clear();
+    for (int s : visible) {
+        const ChunkRing::Slot& slot = ring.getSlot(s);
+        if (slot.meshFaces == 0) {
+            continue;
+        }
+        size_t indexBase = sizeof(glm::uvec3) * meshes.faceCapacity * s;
+        counts.push_back(slot.meshFaces * 3);
+        indexBases.push_back((const void*)indexBase);
+        baseVertices.push_back(meshes.vertexCapacity * s);
+    }
+    if (counts.empty()) {
+        return;
+    }
+    CHECK_GL_ERROR(glBindVertexArray(meshes.vao));
+    CHECK_GL_ERROR(glVertexAttrib3f(1, 0.0f, 0.0f, 0.0f));
+    CHECK_GL_ERROR(glMultiDrawElementsBaseVertex(
+            GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, indexBases.data(),
+            counts.size(), baseVertices.data()));
+}
+
+/* GL_TIME_ELAPSED queries around one pass, kept in a small ring. A query's
+   result is only read once GL_QUERY_RESULT_AVAILABLE says it is there,
+   typically a frame or two later, so timing never waits on the GPU; if
+   every query is still in flight the pass simply goes untimed that frame.
+   Results go to the profiler against the frame that submitted the pass. */
+class GpuTimer {
+    static constexpr int kQueries = 4;
+    GLuint queries[kQueries];
+    uint64_t frames[kQueries];     // Profiler frame of each query
+    TicTocTimer submitted[kQueries];
+    int head = 0;    // Oldest query in flight
+    int pending = 0; // Queries in flight
+    bool running = false;
+    bool supported = false;
+
+    public:
+    void init()
+    {
+        GLint bits = 0;
+        CHECK_GL_ERROR(glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS,
+                                    &bits));
+        this->supported = bits > 0;
+        if (this->supported) {
+            CHECK_GL_ERROR(glGenQueries(kQueries, this->queries));
+        } else {
+            std::cout << "No GPU timer: GL_TIME_ELAPSED has no counter bits"
+                      << std::endl;
+        }
+    }
+
+    void begin(uint64_t frame)
+    {
+        this->running = this->supported && this->pending < kQueries;
+        if (!this->running) {
+            return;
+        }
+        int q = (this->head + this->pending) % kQueries;
+        this->frames[q] = frame;
+        this->submitted[q] = tic();
+        CHECK_GL_ERROR(glBeginQuery(GL_TIME_ELAPSED, this->queries[q]));
+    }
+
+    void end()
+    {
+        if (this->running) {
+            CHECK_GL_ERROR(glEndQuery(GL_TIME_ELAPSED));
+            this->pending++;
+            this->running = false;
+        }
+    }
+
+    // Hand every finished result to the profiler, oldest first
+    void collect(ProfileZone zone)
+    {
+        while (this->pending > 0) {
+            GLuint q = this->queries[this->head];
+            GLint available = 0;
+            CHECK_GL_ERROR(glGetQueryObjectiv(q, GL_QUERY_RESULT_AVAILABLE,
+                                              &available));
+            if (!available) {
+                return;
+            }
+            GLuint64 ns = 0;
+            CHECK_GL_ERROR(glGetQueryObjectui64v(q, GL_QUERY_RESULT, &ns));
+            profiler().recordGpu(zone, this->frames[this->head],
+                                 this->submitted[this->head], ns * 1e-9);
+            this->head = (this->head + 1) % kQueries;
+            this->pending--;
+        }
+    }
+
+    // Deletes the queries; results still in flight are dropped. Needs the
+    // context init() ran in to be current.
+    void release()
+    {
+        if (this->supported) {
+            CHECK_GL_ERROR(glDeleteQueries(kQueries, this->queries));
+            this->supported = false;
+            this->pending = 0;
+        }
+    }
+};
+
 int g_current_button;
 bool g_mouse_pressed;
 
@@ -115,6 +608,10 @@ void MousePosCallback(GLFWwindow* window, double mouse_x, double mouse_y)
     static double prev_x, prev_y;
     if (!g_mouse_pressed)
         return;
+    if (!g_look_pending) {
+        g_look_pending = true;
+        g_look_read = tic();
+    }
     if (g_current_button == GLFW_MOUSE_BUTTON_LEFT) {
         g_camera.lm_rotate_cam(mouse_x - prev_x, mouse_y - prev_y);
     } else if (g_current_button == GLFW_MOUSE_BUTTON_RIGHT) {
@@ -139,9 +636,113 @@ int main(int argc, char* argv[])
         exit(EXIT_FAILURE);
     glfwSetErrorCallback(ErrorCallback);
 
-    // Set up Terrain
+    // Terrain is generated on worker threads unless --sync-terrain is given,
+    // which keeps the old in-loop generation for frame time comparisons.
+    // --view-radius N draws N chunks on each side of the camera's chunk.
+    // --lod-radius N draws downsampled meshes of the chunks beyond it, up
+    // to N chunks from the camera's chunk (greedy meshes only).
+    // --instanced draws one cube instance per block instead of greedy
+    // meshes, and --geometry-shader starts with face normals computed in a
+    // geometry shader (G toggles), both for comparison. --baked-textures
+    // starts with block noise sampled from textures baked at startup rather
+    // than computed per fragment (T toggles); with --no-vsync and a large
+    // window the mean frame times of the two compare fill rate. --no-vsync
+    // lets frame times go below the refresh interval. --world DIR loads
+    // chunks saved in DIR instead of generating them and saves the last view
+    // there on exit; the world's seed is kept in DIR/seed. --seed N starts a
+    // new world from a given seed. --profile prints frame time percentiles
+    // per subsystem, CPU and GPU, on exit, and --trace FILE also writes a
+    // Chrome trace. --tick-rate N runs the simulation at N ticks per second
+    // whatever the frame rate. --entities N drops N mobs and items over the
+    // view and simulates them every tick.
+    bool syncTerrain = false;
+    bool vsync = true;
+    int viewRadius = Terrain::kDefaultViewRadius;
+    int lodRadius = 0;
+    double tickRate = kDefaultTickRate;
+    int entityCount = 0;
+    std::string worldDir;
+    bool profile = false;
+    std::string traceFile;
     srand((unsigned)time(0));
-    Terrain T(rand());
+    uint64_t seed = rand();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sync-terrain") {
+            syncTerrain = true;
+        } else if (arg == "--instanced") {
+            g_meshed = false;
+        } else if (arg == "--geometry-shader") {
+            g_geometry_shader = true;
+        } else if (arg == "--baked-textures") {
+            g_baked_textures = true;
+        } else if (arg == "--no-vsync") {
+            vsync = false;
+        } else if (arg == "--view-radius" && i + 1 < argc) {
+            viewRadius = atoi(argv[++i]);
+        } else if (arg == "--lod-radius" && i + 1 < argc) {
+            lodRadius = atoi(argv[++i]);
+        } else if (arg == "--tick-rate" && i + 1 < argc) {
+            tickRate = std::max(atof(argv[++i]), 1.0);
+        } else if (arg == "--entities" && i + 1 < argc) {
+            entityCount = std::max(atoi(argv[++i]), 0);
+        } else if (arg == "--world" && i + 1 < argc) {
+            worldDir = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            profile = true;
+            traceFile = argv[++i];
+        }
+    }
+    if (profile) {
+        profiler().enable(!traceFile.empty());
+    }
+    if (!worldDir.empty()) {
+        RegionStore::loadSeed(worldDir, seed); // Keeps seed for a new world
+    }
+
+    // Set up Terrain
+    Terrain T(seed);
+    T.setViewRadius(viewRadius);
+    std::shared_ptr<RegionStore> regions;
+    if (!worldDir.empty()) {
+        regions = std::make_shared<RegionStore>(
+                worldDir, seed, T.getChunkExtent(), Terrain::kRenderHeights);
+        T.setRegionStore(regions);
+    }
+    // Keep at least the view and its blending neighbors cached
+    size_t viewChunks = (2 * viewRadius + 3) * (2 * viewRadius + 3);
+    size_t viewBytes = 2 * viewChunks * sizeof(float) * T.getChunkExtent() *
+                       T.getChunkExtent();
+    if (viewBytes > Terrain::kDefaultCacheBytes) {
+        T.setCacheBudget(viewBytes);
+    }
+    // The view radius plus the blending neighbors
+    int prefetchRadius = T.getViewRadius() + 1;
+    // The levels of detail beyond the view, innermost first
+    std::vector<LodRing> lods;
+    if (g_meshed) {
+        std::vector<LodLevel> levels =
+                lodLevels(T.getViewRadius(), lodRadius, T.getChunkExtent());
+        lods.reserve(levels.size());
+        for (size_t k = 1; k < levels.size(); k++) {
+            lods.emplace_back(levels[k]);
+        }
+    }
+    // Far enough to see the corners of the view and its levels of detail
+    int outerRadius = lods.empty() ? T.getViewRadius()
+                                   : lods.back().level.radius;
+    float farPlane = std::max(512.0f, 1.5f * (2 * outerRadius + 1) *
+                                              T.getChunkExtent());
+    std::unique_ptr<TerrainWorkers> workers;
+    if (!syncTerrain) {
+        workers.reset(new TerrainWorkers(T, Terrain::kRenderHeights,
+                                         TerrainWorkers::defaultThreadCount(),
+                                         g_meshed));
+    }
 
     // Ask an OpenGL 4.1 core profile context
     // It is required on OSX and non-NVIDIA Linux
@@ -160,24 +761,15 @@ int main(int argc, char* argv[])
     glfwSetKeyCallback(window, KeyCallback);
     glfwSetCursorPosCallback(window, MousePosCallback);
     glfwSetMouseButtonCallback(window, MouseButtonCallback);
-    glfwSwapInterval(1);
+    glfwSwapInterval(vsync ? 1 : 0);
     const GLubyte* renderer = glGetString(GL_RENDERER); // get renderer string
     const GLubyte* version = glGetString(GL_VERSION);   // version as a string
     std::cout << "Renderer: " << renderer << "\n";
     std::cout << "OpenGL version supported:" << version << "\n";
 
     std::vector<glm::vec4> obj_vertices = CubeData::baseVerts;
+    std::vector<glm::vec3> obj_normals = CubeData::baseNormals;
     std::vector<glm::uvec3> obj_faces = CubeData::baseFaces;
-    std::vector<glm::vec3> offsets;
-    std::vector<float> seeds;
-    seeds.resize(nCubeInstance);
-    offsets.resize(nCubeInstance);
-
-    // Testing
-    for (size_t i = 0; i < offsets.size(); i++) {
-        offsets[i] = glm::vec3(i, i, i);
-        seeds[i] = 1.0;
-    }
 
     glm::vec4 min_bounds = glm::vec4(std::numeric_limits<float>::max());
     glm::vec4 max_bounds = glm::vec4(-std::numeric_limits<float>::max());
@@ -191,6 +783,7 @@ int main(int argc, char* argv[])
     // Setup our VAO array.
     CHECK_GL_ERROR(glGenVertexArrays(kNumVaos, &g_array_objects[0]));
 
+    size_t vertSz = sizeof(float) * obj_vertices.size() * 4;
     // Switch to the VAO for Geometry.
     CHECK_GL_ERROR(glBindVertexArray(g_array_objects[kCubeVao]));
 
@@ -200,31 +793,36 @@ int main(int argc, char* argv[])
     // Setup vertex data in a VBO.
     CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
                                 g_buffer_objects[kCubeVao][kVertexBuffer]));
-    size_t vertSz = sizeof(float) * obj_vertices.size() * 4;
-    size_t offsetSz = sizeof(float) * offsets.size() * 3;
-    size_t seedSz = sizeof(float) * seeds.size();
-    CHECK_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, vertSz + offsetSz + seedSz, 0,
+    CHECK_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, vertSz, obj_vertices.data(),
                                 GL_STATIC_DRAW));
-    CHECK_GL_ERROR(
-            glBufferSubData(GL_ARRAY_BUFFER, 0, vertSz, obj_vertices.data()));
-    CHECK_GL_ERROR(
-            glBufferSubData(GL_ARRAY_BUFFER, vertSz, offsetSz, offsets.data()));
-    CHECK_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, vertSz + offsetSz, seedSz,
-                                   seeds.data()));
 
     // Enable vertex positions to be passed in under location 0
     CHECK_GL_ERROR(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0));
     CHECK_GL_ERROR(glEnableVertexAttribArray(0));
 
+    // Enable face normals to be passed in under location 3
+    CHECK_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER,
+                                g_buffer_objects[kCubeVao][kNormalBuffer]));
+    CHECK_GL_ERROR(glBufferData(GL_ARRAY_BUFFER,
+                                sizeof(glm::vec3) * obj_normals.size(),
+                                obj_normals.data(), GL_STATIC_DRAW));
+    CHECK_GL_ERROR(glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0));
+    CHECK_GL_ERROR(glEnableVertexAttribArray(3));
+
+    // Instance data starts with room for every surface cube plus half as
+    // many seam fillers per chunk. DrawSlots() points attributes 1 and 2
+    // into it.
+    ChunkRing ring(T.getViewRadius());
+    size_t chunkCubes = T.getChunkExtent() * T.getChunkExtent();
+    if (!g_meshed) {
+        AllocateSlots(ring, chunkCubes + chunkCubes / 2);
+    }
+
     // Enable vertex offsets to be passed in under location 1, instanced
-    CHECK_GL_ERROR(
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)vertSz));
     CHECK_GL_ERROR(glEnableVertexAttribArray(1));
     CHECK_GL_ERROR(glVertexAttribDivisor(1, 1)); // Per-instance locations
 
     // Enable random seeds to pass in location 2, instanced
-    CHECK_GL_ERROR(glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0,
-                                         (void*)(vertSz + offsetSz)));
     CHECK_GL_ERROR(glEnableVertexAttribArray(2));
     CHECK_GL_ERROR(glVertexAttribDivisor(2, 1)); // Per-instance locations
 
@@ -235,6 +833,21 @@ int main(int argc, char* argv[])
                                 sizeof(uint32_t) * obj_faces.size() * 3,
                                 obj_faces.data(), GL_STATIC_DRAW));
 
+    // Mesh slots for the view and each level of detail; LOD meshes are
+    // small, so their slots start empty and grow with the first meshes
+    CreateMeshSlots(g_meshes);
+    if (g_meshed) {
+        AllocateMeshSlots(g_meshes, ring, 4 * chunkCubes, 2 * chunkCubes);
+    }
+    for (LodRing& lod : lods) {
+        CreateMeshSlots(lod.meshes);
+    }
+    // The full-detail ring first, then the LOD rings outward
+    std::vector<const ChunkRing*> rings(1, &ring);
+    for (const LodRing& lod : lods) {
+        rings.push_back(&lod.ring);
+    }
+
     // Setup vertex shader.
     GLuint vertex_shader_id = 0;
     const char* vertex_source_pointer = vertex_shader;
@@ -286,31 +899,294 @@ int main(int argc, char* argv[])
     CHECK_GL_ERROR(light_position_location =
                            glGetUniformLocation(program_id, "light_position"));
 
+    // Setup the vertex shader that takes face normals as vertex data, and
+    // a program that goes straight from it to the same fragment shader.
+    GLuint flat_vertex_shader_id = 0;
+    const char* flat_vertex_source_pointer = flat_vertex_shader;
+    CHECK_GL_ERROR(flat_vertex_shader_id = glCreateShader(GL_VERTEX_SHADER));
+    CHECK_GL_ERROR(glShaderSource(flat_vertex_shader_id, 1,
+                                  &flat_vertex_source_pointer, nullptr));
+    glCompileShader(flat_vertex_shader_id);
+    CHECK_GL_SHADER_ERROR(flat_vertex_shader_id);
+
+    GLuint flat_program_id = 0;
+    CHECK_GL_ERROR(flat_program_id = glCreateProgram());
+    CHECK_GL_ERROR(glAttachShader(flat_program_id, flat_vertex_shader_id));
+    CHECK_GL_ERROR(glAttachShader(flat_program_id, fragment_shader_id));
+    CHECK_GL_ERROR(glBindFragDataLocation(flat_program_id, 0,
+                                          "fragment_color"));
+    glLinkProgram(flat_program_id);
+    CHECK_GL_PROGRAM_ERROR(flat_program_id);
+
+    GLint flat_projection_matrix_location = 0;
+    CHECK_GL_ERROR(flat_projection_matrix_location =
+                           glGetUniformLocation(flat_program_id, "projection"));
+    GLint flat_view_matrix_location = 0;
+    CHECK_GL_ERROR(flat_view_matrix_location =
+                           glGetUniformLocation(flat_program_id, "view"));
+    GLint flat_light_position_location = 0;
+    CHECK_GL_ERROR(flat_light_position_location = glGetUniformLocation(
+                           flat_program_id, "light_position"));
+
+    // Bake the block textures for the baked mode; both programs sample them
+    // from texture unit 0
+    GLint baked_textures_location = 0;
+    CHECK_GL_ERROR(baked_textures_location =
+                           glGetUniformLocation(program_id, "baked_textures"));
+    GLint flat_baked_textures_location = 0;
+    CHECK_GL_ERROR(flat_baked_textures_location = glGetUniformLocation(
+                           flat_program_id, "baked_textures"));
+    BlockTextures blockTextures = bakeBlockTextures(seed);
+    GLuint block_texture_id = 0;
+    CHECK_GL_ERROR(glGenTextures(1, &block_texture_id));
+    CHECK_GL_ERROR(glActiveTexture(GL_TEXTURE0));
+    CHECK_GL_ERROR(glBindTexture(GL_TEXTURE_2D_ARRAY, block_texture_id));
+    CHECK_GL_ERROR(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8,
+                                BlockTextures::kSize, BlockTextures::kSize,
+                                BlockTextures::layers(), 0, GL_RGBA,
+                                GL_UNSIGNED_BYTE, blockTextures.texels.data()));
+    CHECK_GL_ERROR(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+    CHECK_GL_ERROR(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                                   GL_LINEAR_MIPMAP_LINEAR));
+    CHECK_GL_ERROR(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                                   GL_LINEAR));
+    CHECK_GL_ERROR(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                                   GL_REPEAT));
+    CHECK_GL_ERROR(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                                   GL_REPEAT));
+    for (GLuint program : {program_id, flat_program_id}) {
+        CHECK_GL_ERROR(glUseProgram(program));
+        CHECK_GL_ERROR(glUniform1i(
+                glGetUniformLocation(program, "block_textures"), 0));
+    }
+
     glm::vec4 light_position = glm::vec4(10.0f, 10.0f, 10.0f, 1.0f);
     float aspect = 0.0f;
     float theta = 0.0f;
+    // The simulation runs in fixed ticks; frames draw the camera between
+    // the last two
+    FixedTimestep simulation(tickRate);
     TicTocTimer timer = tic();
 
-    glm::ivec2 chunkOver(-10000, 100000);
+    // Mobs and items, dropped anywhere over the view from above the camera.
+    // Those over chunks that are not loaded yet wait for them.
+    int entityThreads = 1;
+    if (entityCount > 0) {
+        entityThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+    std::unique_ptr<EntitySystem> entities(new EntitySystem(entityThreads));
+    {
+        glm::vec3 eye = g_camera.getEye();
+        float reach = (T.getViewRadius() + 0.5f) * T.getChunkExtent();
+        for (int i = 0; i < entityCount; i++) {
+            glm::vec3 p(eye.x + reach * (2.0f * rand() / RAND_MAX - 1.0f),
+                        eye.y + 16.0f * rand() / RAND_MAX,
+                        eye.z + reach * (2.0f * rand() / RAND_MAX - 1.0f));
+            entities->spawn(p, i % kMobEvery == 0 ? kMobSize : kItemSize);
+        }
+    }
+
+    // Worst-case frame times, overall and on frames that crossed into a
+    // new chunk or streamed one in. The first frame always builds its view
+    // synchronously and is not counted.
+    TicTocTimer frameTimer = tic();
+    GpuTimer gpuDrawTimer;
+    if (profile) {
+        gpuDrawTimer.init();
+    }
+    double worstFrame = 0.0;
+    double worstCrossingFrame = 0.0;
+    long frameCount = 0;
+    long crossings = 0;
+    // Total time and frames spent on each normal path (0: vertex data,
+    // 1: geometry shader)
+    double pathTime[2] = {0.0, 0.0};
+    long pathFrames[2] = {0, 0};
+    // The same for each way of texturing blocks (0: procedural, 1: baked)
+    double textureTime[2] = {0.0, 0.0};
+    long textureFrames[2] = {0, 0};
+    // Chunks drawn and frustum-culled this frame, and in all counted frames
+    std::vector<int> visibleSlots;
+    int visibleChunks = 0, culledChunks = 0;
+    long visibleTotal = 0, culledTotal = 0;
+    // Block edits: blocks changed, keypresses that changed any, chunks
+    // rebuilt for them, and the time from keypress to the swap of the
+    // first frame drawn with the edit
+    long editedBlocks = 0, editBatches = 0, chunkRebuilds = 0;
+    double editLatencyTotal = 0.0, worstEditLatency = 0.0;
+    bool editPending = false;
+    // How long after falling due each tick ran, summed and squared for the
+    // jitter, and the time from reading input to the swap that shows it
+    double latenessTotal = 0.0, latenessSquares = 0.0, worstLateness = 0.0;
+    double lookLatencyTotal = 0.0, worstLookLatency = 0.0;
+    double moveLatencyTotal = 0.0, worstMoveLatency = 0.0;
+    long lookInputs = 0, moveInputs = 0;
+    // Entity ticks: their count, total and worst time
+    long entityTicks = 0;
+    double entityTickTotal = 0.0, worstEntityTick = 0.0;
+
+    // Collision only needs the chunks around the camera
+    CollisionGrid collision;
+    bool collisionDirty = false;
+    glm::ivec2 chunkOver = kNoChunk; // Center of the view
+    glm::ivec2 prefetchedChunk = kNoChunk;
     while (!glfwWindowShouldClose(window)) {
+        profiler().beginFrame();
+        bool moveShown = false;
+        int ticks = 0;
+        {
+            ScopedTimer physicsTimer(kZonePhysics);
+            // Run the ticks this frame's wall time owes the simulation,
+            // with the input read at the end of the last frame
+            ticks = simulation.advance(toc(&timer));
+            TicTocTimer sinceAdvance = tic();
+            double elapsed = 0.0;
+            for (int k = 0; k < ticks; k++) {
+                elapsed += toc(&sinceAdvance);
+                double late = simulation.lateness(k, ticks) + elapsed;
+                latenessTotal += late;
+                latenessSquares += late * late;
+                worstLateness = std::max(worstLateness, late);
+
+                g_camera.begin_tick();
+                g_camera.update_physics(
+                        simulation.getTickSeconds(),
+                        T.getChunk(T.getChunkCoords(g_camera.getEye())),
+                        collision);
+                if(walk_cam){g_camera.ws_walk_cam(walk_cam, collision);}
+                if(strafe_cam){g_camera.ad_strafe_cam(strafe_cam, collision);}
+                if(roll_cam){g_camera.lr_roll_cam(roll_cam, collision);}
+                if(lev_cam){g_camera.ud_move_cam(lev_cam, collision);}
+            }
+            moveShown = ticks > 0 && g_move_pending;
+        }
+        if (entities->size() > 0) {
+            ScopedTimer timer(kZoneEntities);
+            for (int k = 0; k < ticks; k++) {
+                TicTocTimer entityTimer = tic();
+                entities->tick(simulation.getTickSeconds(), ring);
+                double seconds = toc(&entityTimer);
+                entityTickTotal += seconds;
+                worstEntityTick = std::max(worstEntityTick, seconds);
+                entityTicks++;
+            }
+        }
         glm::ivec2 currChunkOver = T.getChunkCoords(g_camera.getEye());
-        // Copy in new offset data
+        bool crossed = false;
         if (currChunkOver != chunkOver) {
+            bool firstView = (chunkOver == kNoChunk);
             chunkOver = currChunkOver;
-            offsets = T.getOffsetsForRender(g_camera.getEye(),
-                                            glm::vec2(-15.0, 0.0));
-            seeds = T.getSeedsForRender(g_camera.getEye());
-
-            CHECK_GL_ERROR(
-                    glBindBuffer(GL_ARRAY_BUFFER,
-                                 g_buffer_objects[kCubeVao][kVertexBuffer]));
-            size_t vertSz = sizeof(float) * obj_vertices.size() * 4;
-            size_t offsetSz = sizeof(float) * nCubeInstance * 3;
-            size_t seedSz = sizeof(float) * seeds.size();
-            CHECK_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, vertSz, offsetSz,
-                                           offsets.data()));
-            CHECK_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, vertSz + offsetSz,
-                                           seedSz, seeds.data()));
+            std::vector<glm::ivec2> missing = ring.recenter(chunkOver);
+            if (syncTerrain || firstView) {
+                for (const glm::ivec2& c : missing) {
+                    ChunkData chunk;
+                    {
+                        ScopedTimer timer(kZoneTerrain);
+                        chunk.coords = c;
+                        chunk.columns = T.getChunkColumns(
+                                c, Terrain::kRenderHeights);
+                        chunk.blocks = blocksFromColumns(chunk.columns);
+                        if (g_meshed) {
+                            chunk.mesh = T.getChunkMesh(
+                                    c, Terrain::kRenderHeights);
+                        }
+                    }
+                    StreamChunk(ring, chunk);
+                }
+            } else {
+                workers->requestChunks(missing);
+            }
+            // Each level of detail only builds the chunks outside the
+            // level within it
+            const ChunkRing* inner = &ring;
+            for (LodRing& lod : lods) {
+                std::vector<glm::ivec2> lodMissing;
+                for (const glm::ivec2& c : lod.ring.recenter(chunkOver)) {
+                    if (!inner->inView(c)) {
+                        lodMissing.push_back(c);
+                    }
+                }
+                inner = &lod.ring;
+                if (!syncTerrain) {
+                    workers->requestLodChunks(lodMissing, lod.level.step);
+                    continue;
+                }
+                for (const glm::ivec2& c : lodMissing) {
+                    ChunkData chunk;
+                    {
+                        ScopedTimer timer(kZoneTerrain);
+                        chunk.coords = c;
+                        chunk.lodStep = lod.level.step;
+                        chunk.mesh = T.getLodMesh(c, Terrain::kRenderHeights,
+                                                  lod.level.step);
+                    }
+                    StreamLodChunk(lod, chunk);
+                }
+            }
+            if (firstView) {
+                g_uploaded_bytes = 0; // Only count what crossings upload
+            } else {
+                crossings++;
+            }
+            collisionDirty = true;
+            crossed = true;
+        }
+        if (!syncTerrain) {
+            // Warm the surface cache around where the camera is heading
+            glm::vec3 predicted = g_camera.getEye() +
+                                  kPrefetchLookahead * g_camera.getVelocity();
+            glm::ivec2 predictedChunk = T.getChunkCoords(predicted);
+            if (predictedChunk != prefetchedChunk) {
+                prefetchedChunk = predictedChunk;
+                workers->prefetch(predictedChunk, prefetchRadius);
+            }
+
+            // Stream in finished chunks; slots keep their old contents
+            // until then.
+            ChunkData chunk;
+            while (workers->pollChunk(chunk)) {
+                if (chunk.lodStep > 1) {
+                    for (LodRing& lod : lods) {
+                        if (lod.level.step == chunk.lodStep &&
+                            StreamLodChunk(lod, chunk) >= 0) {
+                            crossed = true;
+                        }
+                    }
+                    continue;
+                }
+                glm::ivec2 d = glm::abs(chunk.coords - chunkOver);
+                if (StreamChunk(ring, chunk) >= 0) {
+                    collisionDirty |= (d.x <= 1 && d.y <= 1);
+                    crossed = true;
+                }
+            }
+        }
+        bool editShown = false;
+        if (g_edit != kNoEdit) {
+            ScopedTimer timer(kZoneEdit);
+            int changed = ApplyEdit(ring, g_edit, g_camera.getEye(),
+                                    g_camera.getLook());
+            g_edit = kNoEdit;
+            if (changed > 0) {
+                editedBlocks += changed;
+                editBatches++;
+                editPending = true;
+            }
+        }
+        {
+            ScopedTimer timer(kZoneEdit);
+            int rebuilt = RebuildDirtyChunks(ring);
+            if (rebuilt > 0) {
+                chunkRebuilds += rebuilt;
+                collisionDirty = true;
+                editShown = editPending;
+                editPending = false;
+            }
+        }
+        if (collisionDirty) {
+            ScopedTimer timer(kZonePhysics);
+            collision.build(ring.offsetsNear(chunkOver, 1));
+            collisionDirty = false;
         }
 
         // Setup some basic window stuff.
@@ -321,51 +1197,245 @@ int main(int argc, char* argv[])
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glDepthFunc(GL_LESS);
 
-        // Switch to the Geometry VAO.
-        CHECK_GL_ERROR(glBindVertexArray(g_array_objects[kCubeVao]));
-
         // Compute the projection matrix.
         aspect = static_cast<float>(window_width) / window_height;
-        glm::mat4 projection_matrix =
-                glm::perspective(glm::radians(90.0f), aspect, 0.0001f, 512.0f);
+        glm::mat4 projection_matrix = glm::perspective(
+                glm::radians(90.0f), aspect, 0.0001f, farPlane);
 
-        // Compute the view matrix
-        glm::mat4 view_matrix = g_camera.get_view_matrix();
+        // Late latch: read the newest input, then take the view from it
+        // as close to drawing as possible. Mouse looks apply at once;
+        // movement keys wait for the next tick.
+        glfwPollEvents();
+        bool lookShown = g_look_pending;
+        g_look_pending = false;
+        glm::mat4 view_matrix = g_camera.get_view_matrix(simulation.alpha());
 
         // Use our program.
-        CHECK_GL_ERROR(glUseProgram(program_id));
-
-        // Pass uniforms in.
-        CHECK_GL_ERROR(glUniformMatrix4fv(projection_matrix_location, 1,
-                                          GL_FALSE, &projection_matrix[0][0]));
-        CHECK_GL_ERROR(glUniformMatrix4fv(view_matrix_location, 1, GL_FALSE,
-                                          &view_matrix[0][0]));
-        CHECK_GL_ERROR(
-                glUniform4fv(light_position_location, 1, &light_position[0]));
-
-        // Draw our triangles.
-        CHECK_GL_ERROR(
-                glDrawElementsInstanced(GL_TRIANGLES, obj_faces.size() * 3,
-                                        GL_UNSIGNED_INT, 0, nCubeInstance));
-
-        // Let camera velocities decay
-        double timeDiff = toc(&timer);
-        g_camera.update_physics(
-                timeDiff, T.getChunk(T.getChunkCoords(g_camera.getEye())), offsets);
-        //std::cout << '\r';
-        //std::cout << "FPS = " << 1.0 / timeDiff;
-
-        // Apply camera transforms
-        if(walk_cam){g_camera.ws_walk_cam(walk_cam, offsets);}
-        if(strafe_cam){g_camera.ad_strafe_cam(strafe_cam, offsets);}
-        if(roll_cam){g_camera.lr_roll_cam(roll_cam, offsets);}
-        if(lev_cam){g_camera.ud_move_cam(lev_cam, offsets);}
-
-        // Poll and swap.
-        glfwPollEvents();
+        bool geometryShader = g_geometry_shader; // Constant for the frame
+        bool bakedTextures = g_baked_textures;
+        if (geometryShader) {
+            CHECK_GL_ERROR(glUseProgram(program_id));
+
+            // Pass uniforms in.
+            CHECK_GL_ERROR(glUniformMatrix4fv(projection_matrix_location, 1,
+                                              GL_FALSE,
+                                              &projection_matrix[0][0]));
+            CHECK_GL_ERROR(glUniformMatrix4fv(view_matrix_location, 1,
+                                              GL_FALSE, &view_matrix[0][0]));
+            CHECK_GL_ERROR(glUniform4fv(light_position_location, 1,
+                                        &light_position[0]));
+            CHECK_GL_ERROR(glUniform1i(baked_textures_location,
+                                       bakedTextures));
+        } else {
+            CHECK_GL_ERROR(glUseProgram(flat_program_id));
+            CHECK_GL_ERROR(glUniformMatrix4fv(flat_projection_matrix_location,
+                                              1, GL_FALSE,
+                                              &projection_matrix[0][0]));
+            CHECK_GL_ERROR(glUniformMatrix4fv(flat_view_matrix_location, 1,
+                                              GL_FALSE, &view_matrix[0][0]));
+            CHECK_GL_ERROR(glUniform4fv(flat_light_position_location, 1,
+                                        &light_position[0]));
+            CHECK_GL_ERROR(glUniform1i(flat_baked_textures_location,
+                                       bakedTextures));
+        }
+
+        // Draw our triangles. The first frame is not profiled.
+        bool timeGpu = profile && frameCount > 0;
+        if (timeGpu) {
+            gpuDrawTimer.begin(profiler().frameIndex());
+        }
+        {
+            ScopedTimer drawTimer(kZoneDraw);
+            Frustum frustum(projection_matrix * view_matrix);
+            culledChunks = ring.cull(frustum, visibleSlots);
+            if (!lods.empty()) {
+                KeepDrawnSlots(rings, 0, visibleSlots);
+            }
+            if (g_meshed) {
+                DrawMeshSlots(g_meshes, ring, visibleSlots);
+            } else {
+                DrawSlots(ring, visibleSlots, obj_faces.size() * 3);
+            }
+            visibleChunks = visibleSlots.size();
+            for (size_t k = 0; k < lods.size(); k++) {
+                culledChunks += lods[k].ring.cull(frustum, visibleSlots);
+                KeepDrawnSlots(rings, k + 1, visibleSlots);
+                DrawMeshSlots(lods[k].meshes, lods[k].ring, visibleSlots);
+                visibleChunks += visibleSlots.size();
+            }
+        }
+        if (timeGpu) {
+            gpuDrawTimer.end();
+            gpuDrawTimer.collect(kZoneGpuDraw);
+        }
+
         glfwSwapBuffers(window);
+        if (lookShown) {
+            double latency = toc(&g_look_read);
+            lookLatencyTotal += latency;
+            worstLookLatency = std::max(worstLookLatency, latency);
+            lookInputs++;
+        }
+        if (moveShown) {
+            double latency = toc(&g_move_read);
+            moveLatencyTotal += latency;
+            worstMoveLatency = std::max(worstMoveLatency, latency);
+            moveInputs++;
+            g_move_pending = false;
+        }
+
+        double frameTime = toc(&frameTimer);
+        if (editShown) {
+            double latency = toc(&g_edit_requested);
+            editLatencyTotal += latency;
+            worstEditLatency = std::max(worstEditLatency, latency);
+        }
+        if (frameCount > 0) {
+            profiler().endFrame(crossed);
+        }
+        if (frameCount++ > 0) {
+            pathTime[geometryShader] += frameTime;
+            pathFrames[geometryShader]++;
+            textureTime[bakedTextures] += frameTime;
+            textureFrames[bakedTextures]++;
+            visibleTotal += visibleChunks;
+            culledTotal += culledChunks;
+            worstFrame = std::max(worstFrame, frameTime);
+            if (crossed) {
+                worstCrossingFrame = std::max(worstCrossingFrame, frameTime);
+            }
+        }
     }
     //std::cout << std::endl;
+    workers.reset(); // Join the worker threads before exit()
+    if (regions) {
+        std::vector<ChunkColumns> resident;
+        for (int s = 0; s < ring.slotCount(); s++) {
+            if (ring.getSlot(s).filled) {
+                resident.push_back(ring.getSlot(s).columns);
+            }
+        }
+        if (regions->save(resident) && regions->saveSeed()) {
+            std::cout << "Saved " << resident.size() << " chunks to "
+                      << worldDir << std::endl;
+        }
+    }
+    std::cout << "Terrain generation: "
+              << (syncTerrain ? "synchronous" : "worker threads") << std::endl;
+    std::cout << "Worst frame: " << worstFrame * 1000.0 << " ms, worst "
+              << "chunk-crossing frame: " << worstCrossingFrame * 1000.0
+              << " ms" << std::endl;
+    for (int path = 0; path < 2; path++) {
+        if (pathFrames[path] > 0) {
+            std::cout << "Mean frame with face normals from "
+                      << (path ? "geometry shader: " : "vertex data: ")
+                      << pathTime[path] / pathFrames[path] * 1000.0 << " ms ("
+                      << pathFrames[path] << " frames)" << std::endl;
+        }
+    }
+    for (int baked = 0; baked < 2; baked++) {
+        if (textureFrames[baked] > 0) {
+            std::cout << "Mean frame with "
+                      << (baked ? "baked" : "procedural") << " textures: "
+                      << textureTime[baked] / textureFrames[baked] * 1000.0
+                      << " ms (" << textureFrames[baked] << " frames)"
+                      << std::endl;
+        }
+    }
+    size_t meshTriangles = 0, cubeTriangles = 0;
+    for (int s = 0; s < ring.slotCount(); s++) {
+        meshTriangles += ring.getSlot(s).meshFaces;
+        cubeTriangles += ring.getSlot(s).blocks * obj_faces.size();
+    }
+    std::cout << "Triangles in the last view: " << cubeTriangles
+              << " as instanced cubes";
+    if (g_meshed) {
+        std::cout << ", " << meshTriangles << " meshed";
+    }
+    std::cout << std::endl;
+    for (size_t k = 0; k < lods.size(); k++) {
+        const LodRing& lod = lods[k];
+        size_t lodTriangles = 0;
+        for (int s = 0; s < lod.ring.slotCount(); s++) {
+            const ChunkRing::Slot& slot = lod.ring.getSlot(s);
+            if (slot.filled && DrawingRing(rings, slot.coords) == (int)k + 1) {
+                lodTriangles += slot.meshFaces;
+            }
+        }
+        std::cout << "Level of detail " << lod.level.step << "x"
+                  << lod.level.step << " to radius " << lod.level.radius
+                  << ": " << lodTriangles << " triangles" << std::endl;
+    }
+    long countedFrames = pathFrames[0] + pathFrames[1];
+    if (countedFrames > 0) {
+        std::cout << "Chunks per frame: "
+                  << (double)visibleTotal / countedFrames << " drawn, "
+                  << (double)culledTotal / countedFrames
+                  << " culled by the view frustum (mean)" << std::endl;
+    }
+    std::cout << "Resident terrain: " << ring.residentBytes() / 1024
+              << " KiB of columns and " << ring.blockBytes() / 1024
+              << " KiB of block sections for " << ring.slotCount()
+              << " chunks" << std::endl;
+    long ticks = simulation.tickCount();
+    if (ticks > 0) {
+        double meanLateness = latenessTotal / ticks;
+        double jitter = std::sqrt(std::max(
+                latenessSquares / ticks - meanLateness * meanLateness, 0.0));
+        std::cout << "Simulation: " << ticks << " ticks at " << tickRate
+                  << " Hz (" << simulation.droppedTicks() << " dropped); "
+                  << "tick lateness " << meanLateness * 1000.0
+                  << " ms mean, " << jitter * 1000.0 << " ms jitter, "
+                  << worstLateness * 1000.0 << " ms worst" << std::endl;
+    }
+    if (lookInputs > 0) {
+        std::cout << "Mouse look to swap: "
+                  << lookLatencyTotal / lookInputs * 1000.0 << " ms mean, "
+                  << worstLookLatency * 1000.0 << " ms worst" << std::endl;
+    }
+    if (moveInputs > 0) {
+        std::cout << "Movement key to swap: "
+                  << moveLatencyTotal / moveInputs * 1000.0 << " ms mean, "
+                  << worstMoveLatency * 1000.0 << " ms worst" << std::endl;
+    }
+    if (entityTicks > 0) {
+        std::cout << "Entities: " << entities->size() << " ("
+                  << entities->awakeCount() << " awake in "
+                  << entities->chunkCount() << " chunks) on "
+                  << entities->threadCount() << " threads; tick "
+                  << entityTickTotal / entityTicks * 1000.0 << " ms mean, "
+                  << worstEntityTick * 1000.0 << " ms worst" << std::endl;
+    }
+    if (editBatches > 0) {
+        std::cout << "Block edits: " << editedBlocks << " blocks in "
+                  << editBatches << " edits, " << chunkRebuilds
+                  << " chunk rebuilds; edit to visible "
+                  << editLatencyTotal / editBatches * 1000.0
+                  << " ms mean, " << worstEditLatency * 1000.0 << " ms worst"
+                  << std::endl;
+    }
+    if (crossings > 0) {
+        std::cout << "Instance upload after the first view: "
+                  << g_uploaded_bytes / 1024 << " KiB, "
+                  << g_uploaded_bytes / 1024 / crossings
+                  << " KiB per chunk crossing" << std::endl;
+    }
+    const CacheStats& surfaceStats = T.surfaceCacheStats();
+    const CacheStats& noiseStats = T.noiseCacheStats();
+    std::cout << "Surface cache: " << surfaceStats.hits << " hits, "
+              << surfaceStats.misses << " misses, " << surfaceStats.evictions
+              << " evictions" << std::endl;
+    std::cout << "Noise cache: " << noiseStats.hits << " hits, "
+              << noiseStats.misses << " misses, " << noiseStats.evictions
+              << " evictions" << std::endl;
+    if (profile) {
+        profiler().printSummary(stdout, "crossing");
+        if (!traceFile.empty() && profiler().writeChromeTrace(traceFile)) {
+            std::cout << "Wrote trace to " << traceFile << std::endl;
+        }
+    }
+    entities.reset(); // Join its threads too
+    gpuDrawTimer.release();
     glfwDestroyWindow(window);
     glfwTerminate();
     exit(EXIT_SUCCESS);
@@ -0,0 +1,131 @@
+#include "mesher.h"
+
+Aabb ChunkMesh::bounds() const
+{
+    Aabb box{glm::vec3(0.0f), glm::vec3(0.0f)};
+    for (size_t i = 0; i < this->vertices.size(); i++) {
+        glm::vec3 p(this->vertices[i]);
+        box.min = i == 0 ? p : glm::min(box.min, p);
+        box.max = i == 0 ? p : glm::max(box.max, p);
+    }
+    return box;
+}
+
+namespace {
+// Append the quad at p spanning w blocks along axis u and h along axis v,
+// on the face of p pointing toward dir along axis. attribute is the
+// vertices' w.
+void emitQuad(ChunkMesh& mesh, glm::vec3 p, int axis, int dir, int u, int v,
+              int w, int h, float attribute)
+{
+    if (dir > 0) {
+        p[axis] += 1.0f;
+    }
+    glm::vec3 du(0.0f), dv(0.0f);
+    du[u] = (float)w;
+    dv[v] = (float)h;
+
+    uint32_t base = mesh.vertices.size();
+    mesh.vertices.emplace_back(p, attribute);
+    mesh.vertices.emplace_back(p + du, attribute);
+    mesh.vertices.emplace_back(p + du + dv, attribute);
+    mesh.vertices.emplace_back(p + dv, attribute);
+    glm::vec3 normal(0.0f);
+    normal[axis] = (float)dir;
+    mesh.normals.insert(mesh.normals.end(), 4, normal);
+
+    // u x v points along +axis
+    if (dir > 0) {
+        mesh.faces.emplace_back(base, base + 1, base + 2);
+        mesh.faces.emplace_back(base, base + 2, base + 3);
+    } else {
+        mesh.faces.emplace_back(base, base + 2, base + 1);
+        mesh.faces.emplace_back(base, base + 3, base + 2);
+    }
+}
+}
+
+ChunkMesh greedyMesh(const ChunkVolume& volume, const std::vector<float>& seeds)
+{
+    ChunkMesh mesh;
+    const glm::ivec3& size = volume.getSize();
+    const glm::vec3 origin(volume.getOrigin());
+    int n = size.x - 2; // Columns along the chunk's edge
+
+    // Blocks that belong to the chunk; the apron only occludes
+    const glm::ivec3 lo(1, 0, 1);
+    const glm::ivec3 hi(size.x - 1, size.y, size.z - 1);
+
+    std::vector<uint8_t> mask;
+    for (int axis = 0; axis < 3; axis++) {
+        // (axis, u, v) is a right-handed permutation of (x, y, z)
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        int du = hi[u] - lo[u];
+        int dv = hi[v] - lo[v];
+        mask.resize(du * dv);
+
+        for (int dir = -1; dir <= 1; dir += 2) {
+            glm::ivec3 step(0);
+            step[axis] = dir;
+
+            for (int k = lo[axis]; k < hi[axis]; k++) {
+                // Material of each exposed face in this slice, 0 if none
+                for (int b = 0; b < dv; b++) {
+                    for (int a = 0; a < du; a++) {
+                        glm::ivec3 p;
+                        p[axis] = k;
+                        p[u] = lo[u] + a;
+                        p[v] = lo[v] + b;
+                        uint8_t block = volume.get(p);
+                        bool exposed = block != kAir &&
+                                       volume.get(p + step) == kAir;
+                        mask[a + du * b] = exposed ? block : kAir;
+                        mesh.exposedFaces += exposed;
+                    }
+                }
+
+                // Grow each face into the widest, then tallest, rectangle
+                // of the same material and clear what it covers
+                for (int b = 0; b < dv; b++) {
+                    for (int a = 0; a < du;) {
+                        uint8_t m = mask[a + du * b];
+                        if (m == kAir) {
+                            a++;
+                            continue;
+                        }
+                        int w = 1;
+                        while (a + w < du && mask[a + w + du * b] == m) {
+                            w++;
+                        }
+                        int h = 1;
+                        for (; b + h < dv; h++) {
+                            int c = 0;
+                            while (c < w && mask[a + c + du * (b + h)] == m) {
+                                c++;
+                            }
+                            if (c < w) {
+                                break;
+                            }
+                        }
+                        for (int y = 0; y < h; y++) {
+                            for (int x = 0; x < w; x++) {
+                                mask[a + x + du * (b + y)] = kAir;
+                            }
+                        }
+
+                        glm::ivec3 p;
+                        p[axis] = k;
+                        p[u] = lo[u] + a;
+                        p[v] = lo[v] + b;
+                        float seed = seeds[(p.x - 1) + n * (p.z - 1)];
+                        emitQuad(mesh, origin + glm::vec3(p), axis, dir, u, v,
+                                 w, h, blockAttribute(m, seed));
+                        a += w;
+                    }
+                }
+            }
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,64 @@
+#ifndef MESHER_H
+#define MESHER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "chunkblocks.h"
+#include "frustum.h"
+
+/* The blocks of one chunk in a dense x-fastest, then z, then y array, with a
+   one-block apron of the neighboring chunks' columns around it in x and z so
+   faces on the chunk border can be tested against their neighbors. Anything
+   outside the array, including above and below it, is air. */
+class ChunkVolume {
+    glm::ivec3 origin; // World position of local block (0,0,0)
+    glm::ivec3 size;   // Including the apron
+    std::vector<uint8_t> blocks;
+
+    int index(const glm::ivec3& p) const
+    {
+        return p.x + size.x * (p.z + size.z * p.y);
+    }
+
+    public:
+    ChunkVolume(const glm::ivec3& origin, const glm::ivec3& size)
+        : origin(origin), size(size), blocks(size.x * size.y * size.z, kAir)
+    {
+    }
+
+    const glm::ivec3& getOrigin() const { return origin; }
+    const glm::ivec3& getSize() const { return size; }
+
+    // p is in local coordinates
+    uint8_t get(const glm::ivec3& p) const
+    {
+        if (p.x < 0 || p.y < 0 || p.z < 0 || p.x >= size.x ||
+            p.y >= size.y || p.z >= size.z) {
+            return kAir;
+        }
+        return blocks[index(p)];
+    }
+    void set(const glm::ivec3& p, uint8_t block) { blocks[index(p)] = block; }
+};
+
+struct ChunkMesh {
+    std::vector<glm::vec4> vertices; // World position, w is blockAttribute()
+    std::vector<glm::vec3> normals;  // One per vertex
+    std::vector<glm::uvec3> faces;   // Counter-clockwise seen from outside
+    size_t exposedFaces = 0;         // Unit block faces before merging
+
+    // Around every vertex; empty meshes get a box at the origin
+    Aabb bounds() const;
+};
+
+/* Emits only the block faces that touch air, merging coplanar faces of the
+   same block type into rectangles (greedy meshing). Only blocks inside the
+   apron get faces. seeds holds one texture seed per column of the chunk in
+   the single-index convention; a merged quad takes the seed of its first
+   column. */
+ChunkMesh greedyMesh(const ChunkVolume& volume,
+                     const std::vector<float>& seeds);
+
+#endif
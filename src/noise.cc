@@ -0,0 +1,453 @@
+#include "noise.h"
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+        (defined(__x86_64__) || defined(__i386__))
+#define NOISE_HAVE_X86 1
+#include <immintrin.h>
+#define NOISE_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+// (mid / (sqrt(2) / 2) + 1) / 2 maps the raw noise onto [0,1]
+constexpr float kSqrt2 = 1.41421356237309504880f;
+constexpr double pi = 3.14159265358979323846264338;
+constexpr int kGradientDirections = 256;
+
+// Generate a point on a circle
+glm::vec2 circleSample(float theta)
+{
+    return glm::vec2(std::cos(theta), std::sin(theta));
+}
+
+// Built on first use, so gradients are safe to take during static init
+const std::array<glm::vec2, kGradientDirections>& gradientDirections()
+{
+    static const std::array<glm::vec2, kGradientDirections> directions = [] {
+        std::array<glm::vec2, kGradientDirections> d;
+        for (int i = 0; i < kGradientDirections; i++) {
+            d[i] = circleSample(pi * (i + 0.5) / kGradientDirections);
+        }
+        return d;
+    }();
+    return directions;
+}
+}
+
+uint64_t latticeHash(uint64_t seed, uint64_t salt, int x, int z)
+{
+    auto mix = [](uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    };
+    uint64_t h = mix(seed + 0x9e3779b97f4a7c15ULL * (salt + 1));
+    h = mix(h ^ (uint64_t)(uint32_t)x);
+    h = mix(h ^ ((uint64_t)(uint32_t)z << 32));
+    return h;
+}
+
+glm::vec2 latticeGradient(uint64_t seed, int octave, int x, int z)
+{
+    uint64_t h = latticeHash(seed, octave, x, z);
+    return gradientDirections()[h >> 56]; // The top 8 bits
+}
+
+namespace {
+// 6t^5 - 15t^4 + 10t^3, in the Horner form the SIMD kernels use
+inline float perlinFade(float t)
+{
+    return (t * (6 * t - 15) + 10) * (t * t * t);
+}
+
+inline float lerp(float a, float b, float t)
+{
+    return a + t * (b - a);
+}
+
+// Raw noise, on [-sqrt(2) / 2, sqrt(2) / 2]
+inline float perlinMid(float x, float y, const glm::vec2* grad)
+{
+    float inf0 = grad[0].x * x + grad[0].y * y;
+    float inf1 = grad[1].x * (x - 1) + grad[1].y * y;
+    float inf2 = grad[2].x * x + grad[2].y * (y - 1);
+    float inf3 = grad[3].x * (x - 1) + grad[3].y * (y - 1);
+
+    float fx = perlinFade(x);
+    float bot = lerp(inf0, inf1, fx);
+    float top = lerp(inf2, inf3, fx);
+    return lerp(bot, top, perlinFade(y));
+}
+}
+
+float perlinNoiseSquare(const glm::vec2& coords, const glm::vec2* grad)
+{
+    return perlinMid(coords.x, coords.y, grad) * (kSqrt2 * 0.5f) + 0.5f;
+}
+
+void perlinSpanScalar(const glm::vec2* grad, float y, const float* xs,
+                      float* out, int n, float weight)
+{
+    const float scale = kSqrt2 * 0.5f * weight;
+    const float bias = 0.5f * weight;
+    for (int k = 0; k < n; k++) {
+        out[k] += perlinMid(xs[k], y, grad) * scale + bias;
+    }
+}
+
+void perlinRowScalar(const glm::vec2* lower, const glm::vec2* upper,
+                     const int* cells, float y, const float* xs, float* out,
+                     int n, float weight)
+{
+    const float scale = kSqrt2 * 0.5f * weight;
+    const float bias = 0.5f * weight;
+    for (int k = 0; k < n; k++) {
+        int c = cells[k];
+        const glm::vec2 grad[4] = {lower[c], lower[c + 1], upper[c],
+                                   upper[c + 1]};
+        out[k] += perlinMid(xs[k], y, grad) * scale + bias;
+    }
+}
+
+#ifdef NOISE_HAVE_X86
+
+NOISE_TARGET("sse2")
+void perlinSpanSSE(const glm::vec2* grad, float y, const float* xs, float* out,
+                   int n, float weight)
+{
+    // Everything that depends only on y is the same for the whole span
+    float fy = perlinFade(y);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 c6 = _mm_set1_ps(6.0f);
+    const __m128 c15 = _mm_set1_ps(15.0f);
+    const __m128 c10 = _mm_set1_ps(10.0f);
+    const __m128 g0x = _mm_set1_ps(grad[0].x);
+    const __m128 g1x = _mm_set1_ps(grad[1].x);
+    const __m128 g2x = _mm_set1_ps(grad[2].x);
+    const __m128 g3x = _mm_set1_ps(grad[3].x);
+    const __m128 y0 = _mm_set1_ps(grad[0].y * y);
+    const __m128 y1 = _mm_set1_ps(grad[1].y * y);
+    const __m128 y2 = _mm_set1_ps(grad[2].y * (y - 1));
+    const __m128 y3 = _mm_set1_ps(grad[3].y * (y - 1));
+    const __m128 vfy = _mm_set1_ps(fy);
+    const __m128 scale = _mm_set1_ps(kSqrt2 * 0.5f * weight);
+    const __m128 bias = _mm_set1_ps(0.5f * weight);
+
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128 x = _mm_loadu_ps(xs + k);
+        __m128 xm1 = _mm_sub_ps(x, one);
+
+        __m128 inf0 = _mm_add_ps(_mm_mul_ps(g0x, x), y0);
+        __m128 inf1 = _mm_add_ps(_mm_mul_ps(g1x, xm1), y1);
+        __m128 inf2 = _mm_add_ps(_mm_mul_ps(g2x, x), y2);
+        __m128 inf3 = _mm_add_ps(_mm_mul_ps(g3x, xm1), y3);
+
+        // fade(x) = (x (6x - 15) + 10) x^3
+        __m128 fx = _mm_sub_ps(_mm_mul_ps(c6, x), c15);
+        fx = _mm_add_ps(_mm_mul_ps(fx, x), c10);
+        fx = _mm_mul_ps(fx, _mm_mul_ps(_mm_mul_ps(x, x), x));
+
+        __m128 bot = _mm_add_ps(inf0, _mm_mul_ps(fx, _mm_sub_ps(inf1, inf0)));
+        __m128 top = _mm_add_ps(inf2, _mm_mul_ps(fx, _mm_sub_ps(inf3, inf2)));
+        __m128 mid = _mm_add_ps(bot, _mm_mul_ps(vfy, _mm_sub_ps(top, bot)));
+
+        __m128 acc = _mm_loadu_ps(out + k);
+        acc = _mm_add_ps(acc, _mm_add_ps(_mm_mul_ps(mid, scale), bias));
+        _mm_storeu_ps(out + k, acc);
+    }
+    if (k < n) {
+        perlinSpanScalar(grad, y, xs + k, out + k, n - k, weight);
+    }
+}
+
+NOISE_TARGET("avx2")
+void perlinSpanAVX2(const glm::vec2* grad, float y, const float* xs,
+                    float* out, int n, float weight)
+{
+    float fy = perlinFade(y);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 c6 = _mm256_set1_ps(6.0f);
+    const __m256 c15 = _mm256_set1_ps(15.0f);
+    const __m256 c10 = _mm256_set1_ps(10.0f);
+    const __m256 g0x = _mm256_set1_ps(grad[0].x);
+    const __m256 g1x = _mm256_set1_ps(grad[1].x);
+    const __m256 g2x = _mm256_set1_ps(grad[2].x);
+    const __m256 g3x = _mm256_set1_ps(grad[3].x);
+    const __m256 y0 = _mm256_set1_ps(grad[0].y * y);
+    const __m256 y1 = _mm256_set1_ps(grad[1].y * y);
+    const __m256 y2 = _mm256_set1_ps(grad[2].y * (y - 1));
+    const __m256 y3 = _mm256_set1_ps(grad[3].y * (y - 1));
+    const __m256 vfy = _mm256_set1_ps(fy);
+    const __m256 scale = _mm256_set1_ps(kSqrt2 * 0.5f * weight);
+    const __m256 bias = _mm256_set1_ps(0.5f * weight);
+
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 x = _mm256_loadu_ps(xs + k);
+        __m256 xm1 = _mm256_sub_ps(x, one);
+
+        __m256 inf0 = _mm256_add_ps(_mm256_mul_ps(g0x, x), y0);
+        __m256 inf1 = _mm256_add_ps(_mm256_mul_ps(g1x, xm1), y1);
+        __m256 inf2 = _mm256_add_ps(_mm256_mul_ps(g2x, x), y2);
+        __m256 inf3 = _mm256_add_ps(_mm256_mul_ps(g3x, xm1), y3);
+
+        __m256 fx = _mm256_sub_ps(_mm256_mul_ps(c6, x), c15);
+        fx = _mm256_add_ps(_mm256_mul_ps(fx, x), c10);
+        fx = _mm256_mul_ps(fx, _mm256_mul_ps(_mm256_mul_ps(x, x), x));
+
+        __m256 bot = _mm256_add_ps(
+                inf0, _mm256_mul_ps(fx, _mm256_sub_ps(inf1, inf0)));
+        __m256 top = _mm256_add_ps(
+                inf2, _mm256_mul_ps(fx, _mm256_sub_ps(inf3, inf2)));
+        __m256 mid = _mm256_add_ps(
+                bot, _mm256_mul_ps(vfy, _mm256_sub_ps(top, bot)));
+
+        __m256 acc = _mm256_loadu_ps(out + k);
+        acc = _mm256_add_ps(
+                acc, _mm256_add_ps(_mm256_mul_ps(mid, scale), bias));
+        _mm256_storeu_ps(out + k, acc);
+    }
+    // At most 7 left: finish 4 at a time, then one by one. Short spans
+    // (FractalNoise's high octaves) often have none.
+    if (k < n) {
+        perlinSpanSSE(grad, y, xs + k, out + k, n - k, weight);
+    }
+}
+
+// The row kernels differ from the span kernels only in loading each lane's
+// corner gradients from its own cell
+NOISE_TARGET("sse2")
+void perlinRowSSE(const glm::vec2* lower, const glm::vec2* upper,
+                  const int* cells, float y, const float* xs, float* out,
+                  int n, float weight)
+{
+    float fy = perlinFade(y);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 c6 = _mm_set1_ps(6.0f);
+    const __m128 c15 = _mm_set1_ps(15.0f);
+    const __m128 c10 = _mm_set1_ps(10.0f);
+    const __m128 vy = _mm_set1_ps(y);
+    const __m128 vym1 = _mm_set1_ps(y - 1);
+    const __m128 vfy = _mm_set1_ps(fy);
+    const __m128 scale = _mm_set1_ps(kSqrt2 * 0.5f * weight);
+    const __m128 bias = _mm_set1_ps(0.5f * weight);
+
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const int* c = cells + k;
+        auto lanes = [c](const glm::vec2* g, int corner, int axis) {
+            return _mm_setr_ps(g[c[0] + corner][axis], g[c[1] + corner][axis],
+                               g[c[2] + corner][axis],
+                               g[c[3] + corner][axis]);
+        };
+        __m128 x = _mm_loadu_ps(xs + k);
+        __m128 xm1 = _mm_sub_ps(x, one);
+
+        __m128 inf0 = _mm_add_ps(_mm_mul_ps(lanes(lower, 0, 0), x),
+                                 _mm_mul_ps(lanes(lower, 0, 1), vy));
+        __m128 inf1 = _mm_add_ps(_mm_mul_ps(lanes(lower, 1, 0), xm1),
+                                 _mm_mul_ps(lanes(lower, 1, 1), vy));
+        __m128 inf2 = _mm_add_ps(_mm_mul_ps(lanes(upper, 0, 0), x),
+                                 _mm_mul_ps(lanes(upper, 0, 1), vym1));
+        __m128 inf3 = _mm_add_ps(_mm_mul_ps(lanes(upper, 1, 0), xm1),
+                                 _mm_mul_ps(lanes(upper, 1, 1), vym1));
+
+        __m128 fx = _mm_sub_ps(_mm_mul_ps(c6, x), c15);
+        fx = _mm_add_ps(_mm_mul_ps(fx, x), c10);
+        fx = _mm_mul_ps(fx, _mm_mul_ps(_mm_mul_ps(x, x), x));
+
+        __m128 bot = _mm_add_ps(inf0, _mm_mul_ps(fx, _mm_sub_ps(inf1, inf0)));
+        __m128 top = _mm_add_ps(inf2, _mm_mul_ps(fx, _mm_sub_ps(inf3, inf2)));
+        __m128 mid = _mm_add_ps(bot, _mm_mul_ps(vfy, _mm_sub_ps(top, bot)));
+
+        __m128 acc = _mm_loadu_ps(out + k);
+        acc = _mm_add_ps(acc, _mm_add_ps(_mm_mul_ps(mid, scale), bias));
+        _mm_storeu_ps(out + k, acc);
+    }
+    if (k < n) {
+        perlinRowScalar(lower, upper, cells + k, y, xs + k, out + k, n - k,
+                        weight);
+    }
+}
+
+NOISE_TARGET("avx2")
+inline __m256 dotAVX2(__m256 gx, __m256 x, __m256 gy, __m256 y)
+{
+    return _mm256_add_ps(_mm256_mul_ps(gx, x), _mm256_mul_ps(gy, y));
+}
+
+NOISE_TARGET("avx2")
+void perlinRowAVX2(const glm::vec2* lower, const glm::vec2* upper,
+                   const int* cells, float y, const float* xs, float* out,
+                   int n, float weight)
+{
+    float fy = perlinFade(y);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 c6 = _mm256_set1_ps(6.0f);
+    const __m256 c15 = _mm256_set1_ps(15.0f);
+    const __m256 c10 = _mm256_set1_ps(10.0f);
+    const __m256 vy = _mm256_set1_ps(y);
+    const __m256 vym1 = _mm256_set1_ps(y - 1);
+    const __m256 vfy = _mm256_set1_ps(fy);
+    const __m256 scale = _mm256_set1_ps(kSqrt2 * 0.5f * weight);
+    const __m256 bias = _mm256_set1_ps(0.5f * weight);
+    const float* lo = &lower[0].x;
+    const float* hi = &upper[0].x;
+
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        // Float offsets of each lane's gradients: x at 2c, y at 2c + 1, and
+        // the next corner's at 2c + 2 and 2c + 3
+        __m256i i0 = _mm256_slli_epi32(
+                _mm256_loadu_si256((const __m256i*)(cells + k)), 1);
+        __m256i i1 = _mm256_add_epi32(i0, _mm256_set1_epi32(1));
+        __m256i i2 = _mm256_add_epi32(i0, _mm256_set1_epi32(2));
+        __m256i i3 = _mm256_add_epi32(i0, _mm256_set1_epi32(3));
+        __m256 x = _mm256_loadu_ps(xs + k);
+        __m256 xm1 = _mm256_sub_ps(x, one);
+
+        __m256 inf0 = dotAVX2(_mm256_i32gather_ps(lo, i0, 4), x,
+                              _mm256_i32gather_ps(lo, i1, 4), vy);
+        __m256 inf1 = dotAVX2(_mm256_i32gather_ps(lo, i2, 4), xm1,
+                              _mm256_i32gather_ps(lo, i3, 4), vy);
+        __m256 inf2 = dotAVX2(_mm256_i32gather_ps(hi, i0, 4), x,
+                              _mm256_i32gather_ps(hi, i1, 4), vym1);
+        __m256 inf3 = dotAVX2(_mm256_i32gather_ps(hi, i2, 4), xm1,
+                              _mm256_i32gather_ps(hi, i3, 4), vym1);
+
+        __m256 fx = _mm256_sub_ps(_mm256_mul_ps(c6, x), c15);
+        fx = _mm256_add_ps(_mm256_mul_ps(fx, x), c10);
+        fx = _mm256_mul_ps(fx, _mm256_mul_ps(_mm256_mul_ps(x, x), x));
+
+        __m256 bot = _mm256_add_ps(
+                inf0, _mm256_mul_ps(fx, _mm256_sub_ps(inf1, inf0)));
+        __m256 top = _mm256_add_ps(
+                inf2, _mm256_mul_ps(fx, _mm256_sub_ps(inf3, inf2)));
+        __m256 mid = _mm256_add_ps(
+                bot, _mm256_mul_ps(vfy, _mm256_sub_ps(top, bot)));
+
+        __m256 acc = _mm256_loadu_ps(out + k);
+        acc = _mm256_add_ps(
+                acc, _mm256_add_ps(_mm256_mul_ps(mid, scale), bias));
+        _mm256_storeu_ps(out + k, acc);
+    }
+    if (k < n) {
+        perlinRowSSE(lower, upper, cells + k, y, xs + k, out + k, n - k,
+                     weight);
+    }
+}
+
+#endif
+
+namespace {
+typedef void (*PerlinSpanFn)(const glm::vec2*, float, const float*, float*,
+                             int, float);
+typedef void (*PerlinRowFn)(const glm::vec2*, const glm::vec2*, const int*,
+                            float, const float*, float*, int, float);
+
+bool kernelSupported(NoiseKernel kernel)
+{
+    switch (kernel) {
+        case NoiseKernel::kScalar:
+            return true;
+#ifdef NOISE_HAVE_X86
+        case NoiseKernel::kSSE:
+            return __builtin_cpu_supports("sse2");
+        case NoiseKernel::kAVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+PerlinSpanFn kernelFunction(NoiseKernel kernel)
+{
+    switch (kernel) {
+#ifdef NOISE_HAVE_X86
+        case NoiseKernel::kSSE:
+            return perlinSpanSSE;
+        case NoiseKernel::kAVX2:
+            return perlinSpanAVX2;
+#endif
+        default:
+            return perlinSpanScalar;
+    }
+}
+
+PerlinRowFn rowFunction(NoiseKernel kernel)
+{
+    switch (kernel) {
+#ifdef NOISE_HAVE_X86
+        case NoiseKernel::kSSE:
+            return perlinRowSSE;
+        case NoiseKernel::kAVX2:
+            return perlinRowAVX2;
+#endif
+        default:
+            return perlinRowScalar;
+    }
+}
+
+std::atomic<int>& activeKernel()
+{
+    static std::atomic<int> kernel((int)detectNoiseKernel());
+    return kernel;
+}
+} // namespace
+
+NoiseKernel detectNoiseKernel()
+{
+    if (kernelSupported(NoiseKernel::kAVX2)) {
+        return NoiseKernel::kAVX2;
+    }
+    if (kernelSupported(NoiseKernel::kSSE)) {
+        return NoiseKernel::kSSE;
+    }
+    return NoiseKernel::kScalar;
+}
+
+NoiseKernel getNoiseKernel()
+{
+    return (NoiseKernel)activeKernel().load(std::memory_order_relaxed);
+}
+
+bool setNoiseKernel(NoiseKernel kernel)
+{
+    if (!kernelSupported(kernel)) {
+        return false;
+    }
+    activeKernel().store((int)kernel, std::memory_order_relaxed);
+    return true;
+}
+
+const char* noiseKernelName(NoiseKernel kernel)
+{
+    switch (kernel) {
+        case NoiseKernel::kSSE:
+            return "sse";
+        case NoiseKernel::kAVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+void perlinSpan(const glm::vec2* grad, float y, const float* xs, float* out,
+                int n, float weight)
+{
+    kernelFunction(getNoiseKernel())(grad, y, xs, out, n, weight);
+}
+
+void perlinRow(const glm::vec2* lower, const glm::vec2* upper,
+               const int* cells, float y, const float* xs, float* out, int n,
+               float weight)
+{
+    rowFunction(getNoiseKernel())(lower, upper, cells, y, xs, out, n, weight);
+}
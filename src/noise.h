@@ -0,0 +1,59 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+/* Stateless hash of a lattice point: splitmix64 finalizers applied to the
+   world seed, a per-use salt (octave or texture) and both coordinates. Every
+   chunk that touches a lattice point computes the same value for it, so
+   neighboring chunks agree on their shared edge gradients without ever
+   looking at each other. */
+uint64_t latticeHash(uint64_t seed, uint64_t salt, int x, int z);
+// Gradient at a lattice point: one of 256 directions spread evenly over the
+// upper half circle [0, pi), looked up rather than computed with cos and sin
+// since FractalNoise's fine octaves need hundreds per chunk
+glm::vec2 latticeGradient(uint64_t seed, int octave, int x, int z);
+
+/* Perlin noise kernels.
+
+   The unit of work is a span: n samples on one row (constant y) of a single
+   lattice cell, so all samples share the same four corner gradients. Each
+   kernel accumulates
+
+       out[k] += weight * perlinNoiseSquare(glm::vec2(xs[k], y), grad)
+
+   for 0 <= k < n. The SSE and AVX2 kernels evaluate 4 and 8 samples per
+   instruction with the same operations in the same order as the scalar
+   kernel, and no fused multiply-adds, so every kernel returns the same bits.
+   Terrain heights are rounded from these sums, and the world must not
+   depend on which kernel the CPU picks. */
+
+enum class NoiseKernel { kScalar = 0, kSSE = 1, kAVX2 = 2 };
+
+/* coords: coordinates to take noise at. Scaled to be on a 0-1 square
+   grads: gradients at corners. grad[0] is at (0,0), grad[1] is at (1,0),
+                                grad[2] is at (0,1), grad[3] is at (1,1)
+   This is the scalar reference every kernel is checked against. */
+float perlinNoiseSquare(const glm::vec2& coords, const glm::vec2* grad);
+
+void perlinSpan(const glm::vec2* grad, float y, const float* xs, float* out,
+                int n, float weight);
+/* The same along a row that crosses several cells, for lattices too fine
+   for spans to pay off: sample k lies in cell cells[k], whose corners have
+   the gradients lower[c], lower[c + 1] (at y = 0) and upper[c], upper[c + 1]
+   (at y = 1). Every lane loads its own gradients, so this costs more per
+   sample than a long span but nothing per cell. */
+void perlinRow(const glm::vec2* lower, const glm::vec2* upper,
+               const int* cells, float y, const float* xs, float* out, int n,
+               float weight);
+
+// The best kernel this CPU supports; perlinSpan() uses it unless overridden
+NoiseKernel detectNoiseKernel();
+NoiseKernel getNoiseKernel();
+// Returns false (and changes nothing) if the CPU lacks the instruction set
+bool setNoiseKernel(NoiseKernel kernel);
+const char* noiseKernelName(NoiseKernel kernel);
+
+#endif
@@ -0,0 +1,209 @@
+#include "profiler.h"
+#include <algorithm>
+
+const char* profileZoneName(ProfileZone zone)
+{
+    switch (zone) {
+        case kZoneFrame:
+            return "frame";
+        case kZoneTerrain:
+            return "terrain";
+        case kZoneSeams:
+            return "seams";
+        case kZoneUpload:
+            return "upload";
+        case kZoneEdit:
+            return "edit";
+        case kZonePhysics:
+            return "physics";
+        case kZoneEntities:
+            return "entities";
+        case kZoneDraw:
+            return "draw";
+        case kZoneGpuDraw:
+            return "gpu draw";
+        default:
+            return "?";
+    }
+}
+
+Profiler& profiler()
+{
+    static Profiler instance;
+    return instance;
+}
+
+constexpr size_t Profiler::kFrameCapacity;
+constexpr size_t Profiler::kEventCapacity;
+constexpr uint16_t Profiler::kGpuTrack;
+
+void Profiler::enable(bool tracing)
+{
+    this->tracing = tracing;
+    this->origin = tic();
+    this->frameThread = std::this_thread::get_id();
+    this->threads.assign(1, this->frameThread);
+    this->frames.resize(kFrameCapacity);
+    if (tracing) {
+        this->events.resize(kEventCapacity);
+    }
+    this->enabled = true;
+}
+
+void Profiler::beginFrame()
+{
+    if (!this->isEnabled()) {
+        return;
+    }
+    this->current = Frame();
+    this->frameStart = tic();
+}
+
+void Profiler::endFrame(bool marked)
+{
+    if (!this->isEnabled()) {
+        return;
+    }
+    TicTocTimer start = this->frameStart;
+    TicTocTimer now = start;
+    double seconds = toc(&now);
+    this->record(kZoneFrame, start, seconds);
+    this->current.marked = marked;
+    this->frames[this->frameCount++ % kFrameCapacity] = this->current;
+}
+
+void Profiler::record(ProfileZone zone, const TicTocTimer& start,
+                      double seconds)
+{
+    std::thread::id self = std::this_thread::get_id();
+    if (self == this->frameThread) {
+        this->current.seconds[zone] += seconds;
+    }
+    if (!this->tracing) {
+        return;
+    }
+
+    Event event;
+    event.start = (double)(start.last - this->origin.last) / start.rate;
+    event.duration = seconds;
+    event.zone = zone;
+    std::lock_guard<std::mutex> lock(this->eventMutex);
+    auto it = std::find(this->threads.begin(), this->threads.end(), self);
+    event.thread = it - this->threads.begin();
+    if (it == this->threads.end()) {
+        this->threads.push_back(self);
+    }
+    this->events[this->eventCount++ % kEventCapacity] = event;
+}
+
+void Profiler::recordGpu(ProfileZone zone, uint64_t frame,
+                         const TicTocTimer& start, double seconds)
+{
+    this->gpuZones |= 1u << zone;
+    Frame* f = nullptr;
+    if (frame == this->frameCount) {
+        f = &this->current;
+    } else if (this->frameCount - frame <= kFrameCapacity) {
+        f = &this->frames[frame % kFrameCapacity];
+    }
+    if (f) {
+        f->seconds[zone] += seconds;
+        f->gpuSampled |= 1u << zone;
+    }
+    if (!this->tracing) {
+        return;
+    }
+
+    Event event;
+    event.start = (double)(start.last - this->origin.last) / start.rate;
+    event.duration = seconds;
+    event.zone = zone;
+    event.thread = kGpuTrack;
+    std::lock_guard<std::mutex> lock(this->eventMutex);
+    this->events[this->eventCount++ % kEventCapacity] = event;
+}
+
+ZoneStats Profiler::stats(ProfileZone zone, bool markedOnly) const
+{
+    std::vector<double> samples;
+    size_t kept = std::min(this->frameCount, this->frames.size());
+    unsigned bit = 1u << zone;
+    bool gpu = (this->gpuZones & bit) != 0;
+    for (size_t i = 0; i < kept; i++) {
+        const Frame& f = this->frames[i];
+        if ((!markedOnly || f.marked) && (!gpu || (f.gpuSampled & bit))) {
+            samples.push_back(f.seconds[zone]);
+        }
+    }
+
+    ZoneStats s;
+    s.frames = samples.size();
+    if (samples.empty()) {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    // Nearest rank
+    auto percentile = [&samples](double p) {
+        size_t rank = (size_t)(p * samples.size() + 0.999999);
+        return samples[std::min(std::max(rank, (size_t)1), samples.size()) -
+                       1];
+    };
+    s.p50 = percentile(0.50);
+    s.p95 = percentile(0.95);
+    s.p99 = percentile(0.99);
+    s.max = samples.back();
+    for (double x : samples) {
+        s.mean += x / samples.size();
+    }
+    return s;
+}
+
+void Profiler::printSummary(FILE* out, const char* markedName) const
+{
+    fprintf(out, "%-8s %-9s %6s %8s %8s %8s %8s\n", "zone", "frames", "count",
+            "p50 ms", "p95 ms", "p99 ms", "max ms");
+    for (int z = 0; z < kNumZones; z++) {
+        for (int marked = 0; marked < 2; marked++) {
+            ZoneStats s = this->stats((ProfileZone)z, marked);
+            fprintf(out, "%-8s %-9s %6zu %8.3f %8.3f %8.3f %8.3f\n",
+                    marked ? "" : profileZoneName((ProfileZone)z),
+                    marked ? markedName : "all", s.frames, s.p50 * 1e3,
+                    s.p95 * 1e3, s.p99 * 1e3, s.max * 1e3);
+        }
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(this->eventMutex);
+    size_t kept = std::min(this->eventCount, this->events.size());
+    size_t first = this->eventCount - kept; // Oldest event still kept
+
+    fprintf(f, "{\"traceEvents\": [\n");
+    const char* separator = "";
+    for (size_t t = 0; t < this->threads.size(); t++) {
+        fprintf(f,
+                "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"tid\": %zu, \"args\": {\"name\": \"%s %zu\"}}",
+                separator, t, t == 0 ? "render" : "thread", t);
+        separator = ",\n";
+    }
+    fprintf(f,
+            "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %u, \"args\": {\"name\": \"gpu\"}}",
+            separator, (unsigned)kGpuTrack);
+    for (size_t i = 0; i < kept; i++) {
+        const Event& e = this->events[(first + i) % this->events.size()];
+        fprintf(f,
+                "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                separator, profileZoneName((ProfileZone)e.zone),
+                (unsigned)e.thread, e.start * 1e6, e.duration * 1e6);
+    }
+    fprintf(f, "\n],\n\"displayTimeUnit\": \"ms\"}\n");
+    return fclose(f) == 0;
+}
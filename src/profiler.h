@@ -0,0 +1,136 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tictoc.h"
+
+// What the hot paths are timed as
+enum ProfileZone {
+    kZoneFrame,    // A whole frame, from beginFrame() to endFrame()
+    kZoneTerrain,  // Generating chunk columns and meshes
+    kZoneSeams,    // Filling seams (part of terrain generation)
+    kZoneUpload,   // Copying chunk data into GPU buffers
+    kZoneEdit,     // Applying block edits and rebuilding the edited chunks
+    kZonePhysics,  // Camera physics and collision
+    kZoneEntities, // Entity ticks
+    kZoneDraw,     // Issuing draw calls
+    kZoneGpuDraw,  // GPU time of the draw pass, from timer queries
+    kNumZones
+};
+const char* profileZoneName(ProfileZone zone);
+
+struct ZoneStats {
+    double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0; // Seconds
+    size_t frames = 0;
+};
+
+/* Scoped timers for the hot paths, built on tictoc.
+
+   The render thread brackets each frame with beginFrame() and endFrame();
+   time its ScopedTimers record is summed per zone into that frame, and the
+   last kFrameCapacity frames are kept for percentiles. Frames can be marked
+   (e.g. chunk crossings) to get percentiles over just those.
+
+   With tracing on, every timer on every thread is also kept as an event
+   (the last kEventCapacity of them) for writeChromeTrace(), which writes
+   the chrome://tracing / Perfetto JSON format.
+
+   Disabled, a ScopedTimer costs one relaxed atomic load. */
+class Profiler {
+    struct Frame {
+        float seconds[kNumZones];
+        unsigned gpuSampled; // Bit z: a GPU time for zone z came in
+        bool marked;
+    };
+    struct Event {
+        double start;    // Seconds since enable()
+        double duration; // Seconds
+        uint8_t zone;
+        uint16_t thread; // Index into threads, or kGpuTrack
+    };
+    static constexpr uint16_t kGpuTrack = 0xffff;
+
+    std::atomic<bool> enabled{false};
+    bool tracing = false;
+    TicTocTimer origin;
+
+    // Only touched by the thread that called enable()
+    std::thread::id frameThread;
+    TicTocTimer frameStart;
+    Frame current;
+    std::vector<Frame> frames;
+    size_t frameCount = 0;
+    unsigned gpuZones = 0; // Bit z: zone z is timed by recordGpu()
+
+    mutable std::mutex eventMutex;
+    std::vector<Event> events;
+    size_t eventCount = 0;
+    std::vector<std::thread::id> threads;
+
+    public:
+    static constexpr size_t kFrameCapacity = 1 << 14;
+    static constexpr size_t kEventCapacity = 1 << 18;
+
+    // Not synchronized: call before any timers run, from the thread that
+    // will run frames
+    void enable(bool tracing);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void beginFrame();
+    void endFrame(bool marked);
+    // start is the timer as tic() returned it
+    void record(ProfileZone zone, const TicTocTimer& start, double seconds);
+
+    // The frame in progress; frames are numbered by endFrame() calls
+    uint64_t frameIndex() const { return frameCount; }
+    // GPU time measured for an earlier frame, which is dropped if that
+    // frame has left the ring. start is when the work was submitted; the
+    // trace shows it there, on a track of its own. Frames no GPU time came
+    // in for (the pass went untimed) are left out of the zone's stats.
+    // Render thread only.
+    void recordGpu(ProfileZone zone, uint64_t frame, const TicTocTimer& start,
+                   double seconds);
+
+    // Over the frames kept, or only the marked ones
+    ZoneStats stats(ProfileZone zone, bool markedOnly) const;
+    // One line per zone with its percentiles in ms, over all frames and
+    // over the marked ones
+    void printSummary(FILE* out, const char* markedName) const;
+    bool writeChromeTrace(const std::string& path) const;
+};
+
+// The process-wide profiler
+Profiler& profiler();
+
+class ScopedTimer {
+    ProfileZone zone;
+    bool active;
+    TicTocTimer start;
+
+    public:
+    explicit ScopedTimer(ProfileZone zone)
+        : zone(zone), active(profiler().isEnabled())
+    {
+        if (active) {
+            start = tic();
+        }
+    }
+    ~ScopedTimer()
+    {
+        if (active) {
+            TicTocTimer now = start;
+            profiler().record(zone, start, toc(&now));
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "raycast.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+RayHit traverse(ChunkCursor& cursor, const Ray& ray)
+{
+    RayHit res;
+    float length = glm::length(ray.direction);
+    if (!(length > 0.0f)) {
+        return res;
+    }
+    glm::vec3 d = ray.direction / length;
+    glm::ivec3 cell(glm::floor(ray.origin));
+    glm::ivec3 step;
+    glm::vec3 tMax, tDelta; // Distance to the next boundary, and between two
+    const float inf = std::numeric_limits<float>::infinity();
+    for (int a = 0; a < 3; a++) {
+        step[a] = d[a] > 0.0f ? 1 : d[a] < 0.0f ? -1 : 0;
+        if (step[a] == 0) {
+            tMax[a] = inf;
+            tDelta[a] = inf;
+            continue;
+        }
+        float boundary = step[a] > 0 ? cell[a] + 1.0f : (float)cell[a];
+        tMax[a] = (boundary - ray.origin[a]) / d[a];
+        tDelta[a] = std::fabs(1.0f / d[a]);
+    }
+
+    glm::ivec3 face(0);
+    float t = 0.0f;
+    while (t <= ray.maxDistance) {
+        uint8_t block = cursor.get(cell);
+        if (block != kAir) {
+            res.hit = true;
+            res.block = cell;
+            res.face = face;
+            res.distance = t;
+            res.type = block;
+            return res;
+        }
+        int a = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2)
+                                : (tMax.y < tMax.z ? 1 : 2);
+        t = tMax[a];
+        tMax[a] += tDelta[a];
+        cell[a] += step[a];
+        face = glm::ivec3(0);
+        face[a] = -step[a];
+    }
+    return res;
+}
+}
+
+RayHit raycast(const ChunkRing& ring, const Ray& ray)
+{
+    ChunkCursor cursor(ring);
+    return traverse(cursor, ray);
+}
+
+void raycast(const ChunkRing& ring, const Ray* rays, RayHit* hits, int n)
+{
+    // Nearby rays mostly start in the chunk the last one started in
+    ChunkCursor cursor(ring);
+    for (int i = 0; i < n; i++) {
+        hits[i] = traverse(cursor, rays[i]);
+    }
+}
+
+bool lineOfSight(const ChunkRing& ring, glm::vec3 a, glm::vec3 b)
+{
+    Ray ray{a, b - a, glm::length(b - a)};
+    return !raycast(ring, ray).hit;
+}
@@ -0,0 +1,37 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "chunkring.h"
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;    // Need not be normalized
+    float maxDistance;      // Along the normalized direction
+};
+
+struct RayHit {
+    bool hit = false;
+    glm::ivec3 block;       // The solid block the ray stopped in
+    glm::ivec3 face;        // Normal of the face it entered through; zero
+                            // if the ray started inside the block
+    float distance = 0.0f;  // From the ray's origin to that face
+    uint8_t type = kAir;
+};
+
+/* Grid traversal after Amanatides and Woo: the ray steps from cell to cell
+   across whichever cell boundary it reaches first, so it visits exactly
+   the cells it passes through, and looks each one up in its chunk's
+   blocks in O(1). The chunk is only looked up again when the ray crosses
+   into the next one. Chunks that are not resident are air. */
+RayHit raycast(const ChunkRing& ring, const Ray& ray);
+// n rays at once, e.g. for line of sight; hits[i] is the hit of rays[i]
+void raycast(const ChunkRing& ring, const Ray* rays, RayHit* hits, int n);
+// Whether no solid block lies between a and b (the blocks holding a and b
+// themselves included)
+bool lineOfSight(const ChunkRing& ring, glm::vec3 a, glm::vec3 b);
+
+#endif
@@ -0,0 +1,275 @@
+#include "regionfile.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char kMagic[4] = {'M', 'C', 'R', 'G'};
+constexpr uint32_t kVersion = 2; // 2: terrain from FractalNoise
+constexpr int kTableEntries =
+        RegionFile::kRegionChunks * RegionFile::kRegionChunks;
+constexpr size_t kTableBytes = sizeof(uint32_t) * kTableEntries;
+
+int floorDiv(int a, int n)
+{
+    return a >= 0 ? a / n : -((-a + n - 1) / n);
+}
+
+int slotIndex(glm::ivec2 slot)
+{
+    return slot.x + RegionFile::kRegionChunks * slot.y;
+}
+}
+
+RegionFile::RegionFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 &&
+        (size_t)st.st_size >= sizeof(RegionHeader) + kTableBytes) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            this->data = static_cast<const uint8_t*>(p);
+            this->size = st.st_size;
+        }
+    }
+    close(fd); // The mapping keeps the file alive
+
+    if (this->data && (memcmp(this->header().magic, kMagic, 4) != 0 ||
+                       this->header().version != kVersion ||
+                       this->header().chunkExtent <= 0)) {
+        std::cerr << path << ": not a region file, ignoring it" << std::endl;
+        munmap(const_cast<uint8_t*>(this->data), this->size);
+        this->data = nullptr;
+        this->size = 0;
+    }
+}
+
+RegionFile::~RegionFile()
+{
+    if (this->data) {
+        munmap(const_cast<uint8_t*>(this->data), this->size);
+    }
+}
+
+const RegionHeader& RegionFile::header() const
+{
+    return *reinterpret_cast<const RegionHeader*>(this->data);
+}
+
+const uint32_t* RegionFile::offsets() const
+{
+    return reinterpret_cast<const uint32_t*>(this->data +
+                                             sizeof(RegionHeader));
+}
+
+size_t RegionFile::recordBytes(int chunkExtent)
+{
+    size_t columns = chunkExtent * chunkExtent;
+    size_t bytes = sizeof(uint32_t) + columns * sizeof(int16_t) +
+                   columns * sizeof(uint8_t);
+    return (bytes + 3) & ~(size_t)3;
+}
+
+bool RegionFile::contains(glm::ivec2 slot) const
+{
+    if (!this->isOpen()) {
+        return false;
+    }
+    // Records are written on four-byte boundaries; any other offset is
+    // corrupt
+    uint32_t offset = this->offsets()[slotIndex(slot)];
+    return offset >= sizeof(RegionHeader) + kTableBytes && offset % 4 == 0 &&
+           offset + recordBytes(this->header().chunkExtent) <= this->size;
+}
+
+bool RegionFile::read(glm::ivec2 slot, ChunkColumns& columns) const
+{
+    if (!this->contains(slot)) {
+        return false;
+    }
+    const RegionHeader& h = this->header();
+    int n = h.chunkExtent;
+    const uint8_t* record = this->data + this->offsets()[slotIndex(slot)];
+    const uint8_t* top = record + sizeof(uint32_t);
+    const uint8_t* depth = top + sizeof(int16_t) * n * n;
+
+    columns.origin = (glm::ivec2(h.regionX, h.regionZ) * kRegionChunks +
+                      slot) * n;
+    columns.extent = n;
+    memcpy(&columns.texSeed, record, sizeof(uint32_t));
+    columns.top.resize(n * n);
+    memcpy(columns.top.data(), top, sizeof(int16_t) * n * n);
+    columns.depth.assign(depth, depth + n * n);
+    return true;
+}
+
+RegionStore::RegionStore(const std::string& dir, uint64_t worldSeed,
+                         int chunkExtent, glm::vec2 heights)
+    : dir(dir), worldSeed(worldSeed), chunkExtent(chunkExtent),
+      heights(heights)
+{
+}
+
+glm::ivec2 RegionStore::regionOf(glm::ivec2 chunkCoords)
+{
+    return glm::ivec2(floorDiv(chunkCoords.x, RegionFile::kRegionChunks),
+                      floorDiv(chunkCoords.y, RegionFile::kRegionChunks));
+}
+
+std::string RegionStore::regionPath(glm::ivec2 region) const
+{
+    return this->dir + "/r." + std::to_string(region.x) + "." +
+           std::to_string(region.y) + ".region";
+}
+
+std::shared_ptr<RegionFile> RegionStore::region(glm::ivec2 region)
+{
+    std::lock_guard<std::mutex> lock(this->regionMutex);
+    auto it = this->regions.find(region);
+    if (it != this->regions.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<RegionFile> file =
+            std::make_shared<RegionFile>(this->regionPath(region));
+    if (file->isOpen()) {
+        const RegionHeader& h = file->header();
+        if (h.worldSeed != this->worldSeed ||
+            h.chunkExtent != this->chunkExtent ||
+            h.heights[0] != this->heights.x ||
+            h.heights[1] != this->heights.y || h.regionX != region.x ||
+            h.regionZ != region.y) {
+            file.reset(); // Another world's region
+        }
+    } else {
+        file.reset();
+    }
+    this->regions[region] = file;
+    return file;
+}
+
+bool RegionStore::loadSeed(const std::string& dir, uint64_t& worldSeed)
+{
+    std::ifstream in(dir + "/seed");
+    uint64_t seed;
+    if (!(in >> seed)) {
+        return false;
+    }
+    worldSeed = seed;
+    return true;
+}
+
+bool RegionStore::saveSeed() const
+{
+    std::ofstream out(this->dir + "/seed");
+    out << this->worldSeed << std::endl;
+    return (bool)out;
+}
+
+bool RegionStore::load(glm::ivec2 chunkCoords, ChunkColumns& columns)
+{
+    glm::ivec2 r = regionOf(chunkCoords);
+    std::shared_ptr<RegionFile> file = this->region(r);
+    return file &&
+           file->read(chunkCoords - r * RegionFile::kRegionChunks, columns);
+}
+
+bool RegionStore::save(const std::vector<ChunkColumns>& chunks)
+{
+    if (mkdir(this->dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << this->dir << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Chunks by region, then by slot within it
+    std::map<std::pair<int, int>, std::map<int, const ChunkColumns*>> byRegion;
+    for (const ChunkColumns& c : chunks) {
+        if (c.extent != this->chunkExtent) {
+            continue;
+        }
+        glm::ivec2 coords = c.coords();
+        glm::ivec2 r = regionOf(coords);
+        glm::ivec2 slot = coords - r * RegionFile::kRegionChunks;
+        byRegion[std::make_pair(r.x, r.y)][slotIndex(slot)] = &c;
+    }
+
+    size_t recordBytes = RegionFile::recordBytes(this->chunkExtent);
+    int n = this->chunkExtent;
+    for (const auto& entry : byRegion) {
+        glm::ivec2 r(entry.first.first, entry.first.second);
+
+        // Keep what the current file has unless it is being replaced
+        std::shared_ptr<RegionFile> old = this->region(r);
+        std::vector<ChunkColumns> kept;
+        std::map<int, const ChunkColumns*> records = entry.second;
+        if (old) {
+            kept.reserve(kTableEntries);
+            for (int s = 0; s < kTableEntries; s++) {
+                glm::ivec2 slot(s % RegionFile::kRegionChunks,
+                                s / RegionFile::kRegionChunks);
+                if (!records.count(s) && old->contains(slot)) {
+                    kept.emplace_back();
+                    old->read(slot, kept.back());
+                    records[s] = &kept.back();
+                }
+            }
+        }
+
+        // Zeroed first, so the struct's padding reaches the file as zeros
+        RegionHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kMagic, 4);
+        header.version = kVersion;
+        header.worldSeed = this->worldSeed;
+        header.chunkExtent = n;
+        header.heights[0] = this->heights.x;
+        header.heights[1] = this->heights.y;
+        header.regionX = r.x;
+        header.regionZ = r.y;
+
+        std::vector<uint32_t> offsets(kTableEntries, 0);
+        uint32_t next = sizeof(RegionHeader) + kTableBytes;
+        for (const auto& record : records) {
+            offsets[record.first] = next;
+            next += recordBytes;
+        }
+
+        std::string path = this->regionPath(r);
+        std::string tmpPath = path + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(offsets.data()), kTableBytes);
+        std::vector<char> buffer(recordBytes, 0);
+        for (const auto& record : records) {
+            const ChunkColumns& c = *record.second;
+            memcpy(&buffer[0], &c.texSeed, sizeof(uint32_t));
+            memcpy(&buffer[sizeof(uint32_t)], c.top.data(),
+                   sizeof(int16_t) * n * n);
+            memcpy(&buffer[sizeof(uint32_t) + sizeof(int16_t) * n * n],
+                   c.depth.data(), n * n);
+            out.write(buffer.data(), recordBytes);
+        }
+        out.close();
+        if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::cerr << path << ": could not write region" << std::endl;
+            return false;
+        }
+
+        // Map the new file; the old mapping stays valid until released
+        std::lock_guard<std::mutex> lock(this->regionMutex);
+        this->regions.erase(r);
+    }
+    return true;
+}
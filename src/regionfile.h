@@ -0,0 +1,97 @@
+#ifndef REGIONFILE_H
+#define REGIONFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+#include "chunkcolumns.h"
+
+/* Generated chunks saved to disk, kRegionChunks x kRegionChunks chunks per
+   file. A region file is
+
+     RegionHeader
+     uint32_t offsets[kRegionChunks * kRegionChunks]  (0: chunk not saved)
+     one record per saved chunk, at its offset
+
+   and a record is the chunk's texture seed followed by its columns' tops and
+   depths, padded to four bytes. Chunk (i, j) of the region is entry
+   i + kRegionChunks * j of the table. Everything is in native byte order.
+
+   A region only holds chunks generated for one world seed, chunk extent and
+   pair of render heights; files written for anything else are ignored. */
+struct RegionHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t worldSeed;
+    int32_t chunkExtent;
+    float heights[2];
+    int32_t regionX, regionZ;
+};
+
+// A read-only mapping of one region file
+class RegionFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    const uint32_t* offsets() const;
+
+    public:
+    static constexpr int kRegionChunks = 32;
+
+    // Maps path if it exists and has a valid header; check isOpen()
+    explicit RegionFile(const std::string& path);
+    ~RegionFile();
+    RegionFile(const RegionFile&) = delete;
+    RegionFile& operator=(const RegionFile&) = delete;
+
+    bool isOpen() const { return data != nullptr; }
+    const RegionHeader& header() const;
+    static size_t recordBytes(int chunkExtent);
+
+    // slot is the chunk's position within the region
+    bool contains(glm::ivec2 slot) const;
+    bool read(glm::ivec2 slot, ChunkColumns& columns) const;
+};
+
+/* The region files of one world in a directory, named r.<x>.<z>.region.
+   Regions are mapped the first time one of their chunks is asked for and
+   stay mapped, so a load is a copy out of the page cache. Safe to use from
+   several threads. */
+class RegionStore {
+    std::string dir;
+    uint64_t worldSeed;
+    int chunkExtent;
+    glm::vec2 heights;
+
+    std::mutex regionMutex;
+    // Null entries remember regions that have no usable file
+    std::unordered_map<glm::ivec2, std::shared_ptr<RegionFile>> regions;
+
+    std::shared_ptr<RegionFile> region(glm::ivec2 region);
+
+    public:
+    RegionStore(const std::string& dir, uint64_t worldSeed, int chunkExtent,
+                glm::vec2 heights);
+
+    static glm::ivec2 regionOf(glm::ivec2 chunkCoords);
+    const glm::vec2& getHeights() const { return heights; }
+    std::string regionPath(glm::ivec2 region) const;
+
+    // The world seed is kept next to the regions in <dir>/seed
+    static bool loadSeed(const std::string& dir, uint64_t& worldSeed);
+    bool saveSeed() const;
+
+    bool load(glm::ivec2 chunkCoords, ChunkColumns& columns);
+    // Adds the chunks to their regions' files, keeping the chunks already
+    // saved there. Files are replaced atomically. Returns false and leaves
+    // the rest unsaved on the first error.
+    bool save(const std::vector<ChunkColumns>& chunks);
+};
+
+#endif
@@ -3,10 +3,16 @@ flat in vec4 normal;
 in vec4 light_direction;
 in vec4 world_pos;
 in float seed;
+flat in int block; // BlockMaterial
 in vec4 cube_pos;
 uniform mat4 view;
+uniform bool baked_textures;
+uniform sampler2DArray block_textures;
 out vec4 fragment_color;
 
+// Tiles per block type in BlockTextures
+#define VARIANTS 16
+
 #define PI 3.1415926535897932384626433832795
 
 float rand(vec2 co){
@@ -53,67 +59,78 @@ void main()
         plane_pos = world_pos.xy;
     }
 
-    // Coordinates for octaves
-    vec2 plane_pos_base = floor(plane_pos);
-    vec2 plane_pos_mod = fract(plane_pos);
-
-
-    // O1 noise
-    vec2 o1[4];
-    o1[0] = circle(seed * rand(plane_pos_base));
-    o1[1] = circle(seed * rand(plane_pos_base + vec2(1,0)));
-    o1[2] = circle(seed * rand(plane_pos_base + vec2(0,1)));
-    o1[3] = circle(seed * rand(plane_pos_base + vec2(1,1)));
-
-    float col = perlin(plane_pos_mod, o1);
-
-    // O2 noise
-    vec2 o2[9];
-    o2[0] = circle(seed * rand(plane_pos_base));
-    o2[1] = circle(seed * rand(plane_pos_base + vec2(0.5,0)));
-    o2[2] = circle(seed * rand(plane_pos_base + vec2(1,0)));
-    o2[3] = circle(seed * rand(plane_pos_base + vec2(0,0.5)));
-    o2[4] = circle(seed * rand(plane_pos_base + vec2(0.5,0.5)));
-    o2[5] = circle(seed * rand(plane_pos_base + vec2(1,0.5)));
-    o2[6] = circle(seed * rand(plane_pos_base + vec2(0,1)));
-    o2[7] = circle(seed * rand(plane_pos_base + vec2(0.5,1)));
-    o2[8] = circle(seed * rand(plane_pos_base + vec2(1,1)));
-
-    // Which vectors to use?
-    int start;
-    if(plane_pos_mod.x < 0.5 && plane_pos_mod.y < 0.5){
-        start = 0;
-    }
-    if(plane_pos_mod.x > 0.5 && plane_pos_mod.y < 0.5){
-        start = 1;
-    }
-    if(plane_pos_mod.x < 0.5 && plane_pos_mod.y > 0.5){
-        start = 3;
-    }
-    if(plane_pos_mod.x > 0.5 && plane_pos_mod.y > 0.5){
-        start = 4;
-    }
-    vec2 o2grad[4];
-    o2grad[0] = o2[start];
-    o2grad[1] = o2[start + 1];
-    o2grad[2] = o2[start + 3];
-    o2grad[3] = o2[start + 4];
-
-    //col += perlin(mod(plane_pos_mod * 2.0,2.0), o2grad);
+    // Water, grass or snow: BlockMaterial without air
+    int type = clamp(block - 1, 0, 2);
 
-    vec4 baseCol;
-    if(world_pos.y < -8.999){
-        baseCol = vec4(0.1,0.4,0.8,1.0);
-    }
-    else if(world_pos.y < -6.999){
-        baseCol = vec4(0.3,0.6,0.1,1.0);
+    if(baked_textures){
+        // The same noise, precomputed: the seed picks one of the type's
+        // tiles, which repeats once per block
+        int variant = min(int(seed * VARIANTS), VARIANTS - 1);
+        fragment_color = texture(block_textures,
+                                 vec3(plane_pos, type * VARIANTS + variant));
     }else{
-        baseCol = vec4(1.0,1.0,1.0,1.0);
+        // Coordinates for octaves
+        vec2 plane_pos_base = floor(plane_pos);
+        vec2 plane_pos_mod = fract(plane_pos);
+
+
+        // O1 noise
+        vec2 o1[4];
+        o1[0] = circle(seed * rand(plane_pos_base));
+        o1[1] = circle(seed * rand(plane_pos_base + vec2(1,0)));
+        o1[2] = circle(seed * rand(plane_pos_base + vec2(0,1)));
+        o1[3] = circle(seed * rand(plane_pos_base + vec2(1,1)));
+
+        float col = perlin(plane_pos_mod, o1);
+
+        // O2 noise
+        vec2 o2[9];
+        o2[0] = circle(seed * rand(plane_pos_base));
+        o2[1] = circle(seed * rand(plane_pos_base + vec2(0.5,0)));
+        o2[2] = circle(seed * rand(plane_pos_base + vec2(1,0)));
+        o2[3] = circle(seed * rand(plane_pos_base + vec2(0,0.5)));
+        o2[4] = circle(seed * rand(plane_pos_base + vec2(0.5,0.5)));
+        o2[5] = circle(seed * rand(plane_pos_base + vec2(1,0.5)));
+        o2[6] = circle(seed * rand(plane_pos_base + vec2(0,1)));
+        o2[7] = circle(seed * rand(plane_pos_base + vec2(0.5,1)));
+        o2[8] = circle(seed * rand(plane_pos_base + vec2(1,1)));
+
+        // Which vectors to use?
+        int start;
+        if(plane_pos_mod.x < 0.5 && plane_pos_mod.y < 0.5){
+            start = 0;
+        }
+        if(plane_pos_mod.x > 0.5 && plane_pos_mod.y < 0.5){
+            start = 1;
+        }
+        if(plane_pos_mod.x < 0.5 && plane_pos_mod.y > 0.5){
+            start = 3;
+        }
+        if(plane_pos_mod.x > 0.5 && plane_pos_mod.y > 0.5){
+            start = 4;
+        }
+        vec2 o2grad[4];
+        o2grad[0] = o2[start];
+        o2grad[1] = o2[start + 1];
+        o2grad[2] = o2[start + 3];
+        o2grad[3] = o2[start + 4];
+
+        //col += perlin(mod(plane_pos_mod * 2.0,2.0), o2grad);
+
+        vec4 baseCol;
+        if(type == 0){
+            baseCol = vec4(0.1,0.4,0.8,1.0);
+        }
+        else if(type == 1){
+            baseCol = vec4(0.3,0.6,0.1,1.0);
+        }else{
+            baseCol = vec4(1.0,1.0,1.0,1.0);
+        }
+
+        fragment_color = col * baseCol;
+        fragment_color += vec4(0.10,0.10,0.10, 1.0);
     }
 
-    fragment_color = col * baseCol; 
-    fragment_color += vec4(0.10,0.10,0.10, 1.0);
-
     float dot_nl = dot(normalize(light_direction), view * normalize(normal));
     dot_nl = clamp(dot_nl, 0.3, 1.0);
     fragment_color = clamp( fragment_color * dot_nl, 0.0, 1.0);
@@ -8,14 +8,17 @@ uniform vec4 light_position;
 out vec4 vs_light_direction;
 out vec4 u_pos;
 out float vs_seed;
+flat out int vs_block;
 out vec4 o_pos;
 
+// in_seed is 2 * block type + texture seed (blockAttribute())
 void main()
 {
     u_pos = vertex_position + vec4(cube_offset, 0.0);
     gl_Position = view * u_pos;
     vs_light_direction = -gl_Position + view * light_position;
-    vs_seed = in_seed;
+    vs_block = int(in_seed / 2.0);
+    vs_seed = in_seed - 2.0 * vs_block;
     o_pos = u_pos;
 }
 )zzz"
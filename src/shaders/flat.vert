@@ -0,0 +1,31 @@
+R"zzz(
+#version 330 core
+layout(location = 0) in vec4 vertex_position;
+layout(location = 1) in vec3 cube_offset;
+layout(location = 2) in float in_seed;
+layout(location = 3) in vec3 vertex_normal;
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec4 light_position;
+flat out vec4 normal;
+out vec4 light_direction;
+out vec4 world_pos;
+out vec4 cube_pos;
+out float seed;
+flat out int block;
+
+// default.vert and default.geom in one stage: the face normal comes in as
+// a vertex attribute instead of being computed per triangle. in_seed is
+// 2 * block type + texture seed (blockAttribute()).
+void main()
+{
+    world_pos = vertex_position + vec4(cube_offset, 0.0);
+    vec4 view_pos = view * world_pos;
+    gl_Position = projection * view_pos;
+    light_direction = -view_pos + view * light_position;
+    normal = vec4(vertex_normal, 0.0);
+    block = int(in_seed / 2.0);
+    seed = in_seed - 2.0 * block;
+    cube_pos = vertex_position;
+}
+)zzz"
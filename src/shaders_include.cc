@@ -2,6 +2,10 @@ const char* vertex_shader =
   #include "shaders/default.vert"
     ;
 
+const char* flat_vertex_shader =
+  #include "shaders/flat.vert"
+    ;
+
 const char* geometry_shader =
   #include "shaders/default.geom"
     ;
@@ -0,0 +1,1286 @@
+// Headless terrain benchmark. Needs no GL context, so it runs on CI boxes.
+//
+//   terrain_bench [--radius R] [--view-radius V] [--extent E] [--iters N]
+//                 [--seed S] [--json]
+//
+// Reports chunk generation throughput over a (2R+1)^2 area, noise kernel
+// cost, fractal noise cost per octave, view assembly latency and instance
+// count for view radius V, seam filling time, bytes streamed per chunk
+// crossing, greedy meshing cost and triangle counts, collision query cost,
+// region file load cost against generation, block texture baking cost,
+// chunks frustum-culled per view, triangles drawn with levels of detail out
+// to kLodRadius chunks, block section footprint and lookup cost, block edit
+// latency and rebuilds per burst of edits, voxel raycasts per second against
+// a linear scan, how far fixed-timestep and per-frame camera physics drift
+// with the frame rate, entity tick cost on one and on every hardware thread,
+// profiler overhead and peak RSS.
+// With --json a single JSON object is written to stdout so results can be
+// tracked over time. Exits non-zero if a check it makes along the way fails,
+// so CTest runs it too; the standalone checks are in terrain_tests.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Terrain.h"
+#include "blocktextures.h"
+#include "camera.h"
+#include "chunkring.h"
+#include "collisiongrid.h"
+#include "entities.h"
+#include "fixedtimestep.h"
+#include "fractalnoise.h"
+#include "frustum.h"
+#include "mesher.h"
+#include "noise.h"
+#include "profiler.h"
+#include "raycast.h"
+#include "regionfile.h"
+#include "terrain_fixtures.h"
+#include "tictoc.h"
+
+namespace {
+const glm::vec2& kHeights = Terrain::kRenderHeights;
+
+struct Options {
+    int radius = 2;
+    int viewRadius = Terrain::kDefaultViewRadius;
+    int extent = 32;
+    int iters = 5;
+    uint64_t seed = 1;
+    bool json = false;
+};
+
+struct KernelResult {
+    NoiseKernel kernel;
+    double nsPerSample;
+    double samplesPerSec;
+    double maxError; // Against the scalar kernel
+};
+
+struct Latency {
+    double mean = 0.0;
+    double max = 0.0;
+
+    void add(double seconds, int n)
+    {
+        mean += seconds / n;
+        max = std::max(max, seconds);
+    }
+};
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--radius R] [--view-radius V] [--extent E] "
+            "[--iters N] [--seed S] [--json]\n",
+            argv0);
+    exit(EXIT_FAILURE);
+}
+
+Options parseArgs(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json") {
+            opt.json = true;
+        } else if (arg == "--radius" && hasValue) {
+            opt.radius = atoi(argv[++i]);
+        } else if (arg == "--view-radius" && hasValue) {
+            opt.viewRadius = atoi(argv[++i]);
+        } else if (arg == "--extent" && hasValue) {
+            opt.extent = atoi(argv[++i]);
+        } else if (arg == "--iters" && hasValue) {
+            opt.iters = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            opt.seed = strtoull(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.radius < 0 || opt.viewRadius < 0 || opt.extent < 2 ||
+        opt.iters < 1) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+// Peak resident set size in bytes
+long peakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024L;
+#endif
+}
+
+// Cold generation: a fresh Terrain per iteration, so every chunk in the
+// (2R+1)^2 area is generated from scratch (raw noise plus edge blending).
+double chunksPerSecond(const Options& opt)
+{
+    int side = 2 * opt.radius + 1;
+    double seconds = 0.0;
+    for (int it = 0; it < opt.iters; it++) {
+        Terrain T(opt.seed + it, opt.extent);
+        TicTocTimer timer = tic();
+        for (int i = -opt.radius; i <= opt.radius; i++) {
+            for (int j = -opt.radius; j <= opt.radius; j++) {
+                T.chunkSurface(glm::ivec2(i, j), kHeights);
+            }
+        }
+        seconds += toc(&timer);
+    }
+    return (double)side * side * opt.iters / seconds;
+}
+
+std::vector<KernelResult> benchKernels(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    std::vector<Chunk> chunks;
+    for (int i = 0; i < 64; i++) {
+        chunks.push_back(T.getChunk(glm::ivec2(i % 8, i / 8)));
+    }
+    long samples = (long)chunks.size() * opt.extent * opt.extent;
+
+    NoiseKernel original = getNoiseKernel();
+    std::vector<std::vector<float>> reference;
+    std::vector<KernelResult> results;
+    for (NoiseKernel k :
+         {NoiseKernel::kScalar, NoiseKernel::kSSE, NoiseKernel::kAVX2}) {
+        if (!setNoiseKernel(k)) {
+            continue;
+        }
+        KernelResult r;
+        r.kernel = k;
+        r.maxError = 0.0;
+
+        std::vector<std::vector<float>> outputs;
+        double best = 1e30;
+        for (int it = 0; it < opt.iters; it++) {
+            outputs.clear();
+            TicTocTimer timer = tic();
+            for (const Chunk& C : chunks) {
+                outputs.push_back(C.genPerlinNoise());
+            }
+            best = std::min(best, toc(&timer));
+        }
+        if (reference.empty()) {
+            reference = outputs;
+        }
+        for (size_t c = 0; c < outputs.size(); c++) {
+            for (size_t i = 0; i < outputs[c].size(); i++) {
+                double err = fabs(outputs[c][i] - reference[c][i]);
+                r.maxError = std::max(r.maxError, err);
+            }
+        }
+        r.nsPerSample = best * 1e9 / samples;
+        r.samplesPerSec = samples / best;
+        results.push_back(r);
+    }
+    setNoiseKernel(original);
+    return results;
+}
+
+struct OctaveResult {
+    int octaves;
+    double nsPerSample; // FractalNoise::tile(), whole tiles
+};
+
+// fBm from an eighth of a lattice cell per chunk edge, doubling, so eight
+// octaves end at 16 cells per chunk edge
+template <int Octaves>
+OctaveResult octaveCost(const Options& opt)
+{
+    FractalNoise<Octaves> noise(opt.seed, 0.125f, 2.0f, 0.5f);
+    std::vector<float> out(opt.extent * opt.extent);
+    const int tiles = 64;
+    double best = 1e30;
+    for (int it = 0; it < opt.iters; it++) {
+        TicTocTimer timer = tic();
+        for (int i = 0; i < tiles; i++) {
+            noise.tile(glm::ivec2(i % 8, i / 8), opt.extent, out.data());
+        }
+        best = std::min(best, toc(&timer));
+    }
+    return OctaveResult{Octaves, best * 1e9 / ((double)tiles * out.size())};
+}
+
+std::vector<OctaveResult> benchOctaves(const Options& opt)
+{
+    return {octaveCost<1>(opt), octaveCost<2>(opt), octaveCost<4>(opt),
+            octaveCost<8>(opt)};
+}
+
+// getOffsetsForRender() for a fresh Terrain (cold) and for a walk across
+// chunk boundaries with a warm cache (every step exposes one new column).
+// instances is the number of cubes the cold view asks the GPU to draw.
+void benchOffsets(const Options& opt, Latency& cold, Latency& warm,
+                  size_t& instances)
+{
+    for (int it = 0; it < opt.iters; it++) {
+        Terrain T(opt.seed + it, opt.extent);
+        T.setViewRadius(opt.viewRadius);
+        TicTocTimer timer = tic();
+        instances = T.getOffsetsForRender(T.getChunkCenter(glm::ivec2(0, 0)),
+                                          kHeights)
+                            .size();
+        cold.add(toc(&timer), opt.iters);
+
+        for (int step = 1; step <= 8; step++) {
+            glm::vec3 eye = T.getChunkCenter(glm::ivec2(step, 0));
+            timer = tic();
+            T.getOffsetsForRender(eye, kHeights);
+            warm.add(toc(&timer), opt.iters * 8);
+        }
+    }
+}
+
+// fixNeighborGaps() as it was before it counted and reserved: a vector of
+// neighbors per cell, a stack of fillers per lower neighbor, rows that wrap
+// and cell 0 never treated as a neighbor. Kept for the before/after numbers.
+void legacyFixNeighborGaps(std::vector<glm::vec3>& surfaceMap, int chunkExtent)
+{
+    for (int i = (int)surfaceMap.size() - 1; i >= 0; i--) {
+        std::vector<int> neighbors = {i + 1, i - 1, i + chunkExtent,
+                                      i - chunkExtent};
+        for (int j : neighbors) {
+            if (j < chunkExtent * chunkExtent && j > 0) {
+                float gapSize =
+                        floor(surfaceMap[i].y - surfaceMap[j].y - 0.001);
+                if (gapSize <= 0.0)
+                    continue;
+                for (int k = 1; k <= gapSize; k++) {
+                    surfaceMap.push_back(glm::vec3(surfaceMap[i].x,
+                                                   surfaceMap[i].y - (float)k,
+                                                   surfaceMap[i].z));
+                }
+            }
+        }
+    }
+}
+
+void benchSeams(const Options& opt, Latency& seams, Latency& legacy,
+                size_t& fillers, size_t& legacyFillers)
+{
+    Terrain T(opt.seed, opt.extent);
+    T.setViewRadius(opt.viewRadius);
+    std::vector<glm::vec3> surface =
+            T.viewSurface(glm::ivec2(0, 0), kHeights);
+    for (int it = 0; it < opt.iters; it++) {
+        std::vector<glm::vec3> offsets = surface;
+        TicTocTimer timer = tic();
+        fixNeighborGaps(offsets, T.viewEdge());
+        seams.add(toc(&timer), opt.iters);
+        fillers = offsets.size() - surface.size();
+
+        offsets = surface;
+        timer = tic();
+        legacyFixNeighborGaps(offsets, T.viewEdge());
+        legacy.add(toc(&timer), opt.iters);
+        legacyFillers = offsets.size() - surface.size();
+    }
+}
+
+struct StreamResult {
+    double ringBytes; // Per crossing, uploading only the new chunks' slots
+    double fullBytes; // Per crossing, re-uploading the whole view
+    Latency chunks;   // Generating the new chunks of one crossing
+    size_t columnBytes;   // Held by the ring for the final view
+    size_t expandedBytes; // The same view as offsets and seeds
+};
+
+// Walk 8 chunks along +x the way the renderer does: recenter a ChunkRing and
+// generate what it reports missing. Instances are 16 bytes (offset + seed),
+// which is also what one cube cost to keep as separate offset and seed
+// vectors before chunks were stored as columns.
+StreamResult benchStreaming(const Options& opt)
+{
+    const int steps = 8;
+    Terrain T(opt.seed, opt.extent);
+    T.setViewRadius(opt.viewRadius);
+    ChunkRing ring(opt.viewRadius);
+
+    StreamResult res;
+    res.ringBytes = 0.0;
+    res.fullBytes = 0.0;
+    for (int step = 0; step <= steps; step++) {
+        TicTocTimer timer = tic();
+        size_t uploaded = 0;
+        for (const glm::ivec2& c : ring.recenter(glm::ivec2(step, 0))) {
+            ChunkData chunk;
+            chunk.coords = c;
+            chunk.columns = T.getChunkColumns(c, kHeights);
+            uploaded += chunk.columns.blockCount();
+            ring.store(chunk);
+        }
+        double seconds = toc(&timer);
+        if (step == 0) {
+            continue; // The initial view is uploaded either way
+        }
+        size_t resident = 0;
+        for (int s = 0; s < ring.slotCount(); s++) {
+            resident += ring.getSlot(s).blocks;
+        }
+        res.ringBytes += 16.0 * uploaded / steps;
+        res.fullBytes += 16.0 * resident / steps;
+        res.chunks.add(seconds, steps);
+        res.expandedBytes = 16 * resident;
+    }
+    res.columnBytes = ring.residentBytes();
+    return res;
+}
+
+struct MeshResult {
+    double cubeTriangles; // Per chunk, drawn as 12-triangle instanced cubes
+    double meshTriangles; // Per chunk, greedy meshed
+    double exposedFaces;  // Per chunk, unit faces touching air
+    double meshBytes;     // Per chunk, vertices, normals and faces
+    Latency build;        // Volume plus mesh, per chunk
+};
+
+MeshResult benchMeshing(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    MeshResult res;
+    res.cubeTriangles = res.meshTriangles = res.exposedFaces = 0.0;
+    res.meshBytes = 0.0;
+    int side = 2 * opt.viewRadius + 1;
+    int nChunks = side * side;
+    for (int i = -opt.viewRadius; i <= opt.viewRadius; i++) {
+        for (int j = -opt.viewRadius; j <= opt.viewRadius; j++) {
+            glm::ivec2 c(i, j);
+            ChunkColumns columns = T.getChunkColumns(c, kHeights);
+            TicTocTimer timer = tic();
+            ChunkMesh mesh = T.getChunkMesh(c, kHeights);
+            res.build.add(toc(&timer), nChunks);
+            res.cubeTriangles += 12.0 * columns.blockCount() / nChunks;
+            res.meshTriangles += (double)mesh.faces.size() / nChunks;
+            res.exposedFaces += (double)mesh.exposedFaces / nChunks;
+            res.meshBytes += (sizeof(glm::vec4) * mesh.vertices.size() +
+                              sizeof(glm::vec3) * mesh.normals.size() +
+                              sizeof(glm::uvec3) * mesh.faces.size()) /
+                             (double)nChunks;
+        }
+    }
+    return res;
+}
+
+struct CollisionResult {
+    double linearNs; // Per query, scanning every instance
+    double gridNs;   // Per query, through CollisionGrid
+    double buildMs;
+    int mismatches;  // Queries where the two disagree
+};
+
+// The camera's coarse test (any cube within r of the eye), asked at points
+// just above the surface of a full render view.
+CollisionResult benchCollision(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    T.setViewRadius(opt.viewRadius);
+    std::vector<glm::vec3> offsets =
+            T.getOffsetsForRender(T.getChunkCenter(glm::ivec2(0, 0)), kHeights);
+    std::vector<glm::vec3> probes;
+    for (size_t i = 0; i < offsets.size(); i += 37) {
+        probes.push_back(offsets[i] + glm::vec3(0.3f, 1.2f, 0.6f));
+    }
+    const float r = 1.5f + sqrt(0.5f * 0.5f + 1.75f * 1.75f);
+
+    CollisionResult res;
+    CollisionGrid grid;
+    TicTocTimer timer = tic();
+    for (int it = 0; it < opt.iters; it++) {
+        grid.build(offsets);
+    }
+    res.buildMs = toc(&timer) * 1e3 / opt.iters;
+
+    std::vector<char> linear(probes.size()), fast(probes.size());
+    timer = tic();
+    for (size_t p = 0; p < probes.size(); p++) {
+        bool hit = false;
+        for (const auto& c : offsets) {
+            if (glm::length(c - probes[p]) < r) {
+                hit = true;
+                break;
+            }
+        }
+        linear[p] = hit;
+    }
+    res.linearNs = toc(&timer) * 1e9 / probes.size();
+
+    timer = tic();
+    for (int it = 0; it < opt.iters; it++) {
+        for (size_t p = 0; p < probes.size(); p++) {
+            fast[p] = grid.anyWithin(probes[p], r);
+        }
+    }
+    res.gridNs = toc(&timer) * 1e9 / (probes.size() * opt.iters);
+
+    res.mismatches = 0;
+    for (size_t p = 0; p < probes.size(); p++) {
+        res.mismatches += linear[p] != fast[p];
+    }
+    return res;
+}
+struct RegionResult {
+    Latency generate; // Columns and volume of one chunk, from noise
+    Latency load;     // The same from region files
+    size_t fileBytes; // All region files written for the view
+    int mismatches;   // Chunks whose loaded data differs
+};
+
+bool sameVolume(const ChunkVolume& a, const ChunkVolume& b)
+{
+    if (a.getOrigin() != b.getOrigin() || a.getSize() != b.getSize()) {
+        return false;
+    }
+    const glm::ivec3& size = a.getSize();
+    for (int y = 0; y < size.y; y++) {
+        for (int z = 0; z < size.z; z++) {
+            for (int x = 0; x < size.x; x++) {
+                glm::ivec3 p(x, y, z);
+                if (a.get(p) != b.get(p)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Save the view and its neighbors to region files in a scratch directory,
+// then build every chunk of the view twice: from noise on a fresh Terrain,
+// and from the files on another one (a warm restart)
+RegionResult benchRegions(const Options& opt)
+{
+    RegionResult res;
+    res.fileBytes = 0;
+    res.mismatches = 0;
+    char dir[] = "/tmp/terrain_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        return res;
+    }
+
+    int r = opt.viewRadius;
+    std::vector<ChunkColumns> saved;
+    {
+        Terrain T(opt.seed, opt.extent);
+        for (int j = -r - 1; j <= r + 1; j++) {
+            for (int i = -r - 1; i <= r + 1; i++) {
+                saved.push_back(T.getChunkColumns(glm::ivec2(i, j), kHeights));
+            }
+        }
+    }
+    RegionStore store(dir, opt.seed, opt.extent, kHeights);
+    store.save(saved);
+
+    Terrain generated(opt.seed, opt.extent);
+    Terrain loaded(opt.seed, opt.extent);
+    loaded.setRegionStore(std::make_shared<RegionStore>(dir, opt.seed,
+                                                        opt.extent, kHeights));
+    int nChunks = (2 * r + 1) * (2 * r + 1);
+    for (int j = -r; j <= r; j++) {
+        for (int i = -r; i <= r; i++) {
+            glm::ivec2 c(i, j);
+            TicTocTimer timer = tic();
+            ChunkColumns a = generated.getChunkColumns(c, kHeights);
+            ChunkVolume va = generated.getChunkVolume(c, kHeights);
+            res.generate.add(toc(&timer), nChunks);
+
+            timer = tic();
+            ChunkColumns b = loaded.getChunkColumns(c, kHeights);
+            ChunkVolume vb = loaded.getChunkVolume(c, kHeights);
+            res.load.add(toc(&timer), nChunks);
+
+            bool same = a.origin == b.origin && a.texSeed == b.texSeed &&
+                        a.top == b.top && a.depth == b.depth &&
+                        sameVolume(va, vb);
+            res.mismatches += !same;
+        }
+    }
+
+    // Clean up the scratch directory
+    std::vector<glm::ivec2> regions;
+    for (const ChunkColumns& c : saved) {
+        glm::ivec2 region = RegionStore::regionOf(c.coords());
+        if (std::find(regions.begin(), regions.end(), region) ==
+            regions.end()) {
+            regions.push_back(region);
+        }
+    }
+    for (const glm::ivec2& region : regions) {
+        std::string path = store.regionPath(region);
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            res.fileBytes += ftell(f);
+            fclose(f);
+        }
+        unlink(path.c_str());
+    }
+    rmdir(dir);
+    return res;
+}
+
+// What baking the block textures adds to startup
+Latency benchBlockTextures(const Options& opt, size_t& bytes)
+{
+    Latency bake;
+    for (int it = 0; it < opt.iters; it++) {
+        TicTocTimer timer = tic();
+        BlockTextures textures = bakeBlockTextures(opt.seed + it);
+        bake.add(toc(&timer), opt.iters);
+        bytes = textures.bytes();
+    }
+    return bake;
+}
+
+struct CullResult {
+    double visible;     // Chunks drawn per view, over eight headings
+    double culled;      // Chunks culled per view
+    double nsPerChunk;  // ChunkRing::cull() per filled slot
+};
+
+// The view around chunk (0, 0) seen level from just above the terrain at
+// its center, turning through eight headings, with the renderer's 90 degree
+// 4:3 projection
+CullResult benchCulling(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    T.setViewRadius(opt.viewRadius);
+    ChunkRing ring(opt.viewRadius);
+    for (const glm::ivec2& c : ring.recenter(glm::ivec2(0, 0))) {
+        ChunkData chunk;
+        chunk.coords = c;
+        chunk.columns = T.getChunkColumns(c, kHeights);
+        ring.store(chunk);
+    }
+    float farPlane = std::max(512.0f, 1.5f * T.viewEdge());
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 4.0f / 3.0f,
+                                            0.0001f, farPlane);
+    glm::vec3 eye(opt.extent / 2.0f, kHeights.y + 2.0f, opt.extent / 2.0f);
+
+    CullResult res;
+    res.visible = 0.0;
+    res.culled = 0.0;
+    const int headings = 8;
+    const int reps = 1000 * opt.iters;
+    std::vector<int> visible;
+    double seconds = 0.0;
+    for (int h = 0; h < headings; h++) {
+        float yaw = 2.0f * 3.14159265f * h / headings;
+        glm::vec3 ahead(cos(yaw), 0.0f, sin(yaw));
+        Frustum frustum(projection * glm::lookAt(eye, eye + ahead,
+                                                 glm::vec3(0, 1, 0)));
+        int culled = 0;
+        TicTocTimer timer = tic();
+        for (int r = 0; r < reps; r++) {
+            culled = ring.cull(frustum, visible);
+        }
+        seconds += toc(&timer);
+        res.visible += (double)visible.size() / headings;
+        res.culled += (double)culled / headings;
+    }
+    res.nsPerChunk = seconds * 1e9 / ((double)headings * reps *
+                                      (res.visible + res.culled));
+    return res;
+}
+
+// Chunks the LOD section draws to on each side of the view center
+constexpr int kLodRadius = 32;
+
+struct LodResult {
+    int levels;            // Including the full-detail view
+    long chunks;           // Drawn at a coarser level
+    double lodTriangles;   // Of all the coarse chunks
+    double viewTriangles;  // Of the full-detail view, meshed
+    double fullTriangles;  // Estimated for every chunk at full detail
+    Latency build;         // getLodMesh(), per chunk
+};
+
+// The view around chunk (0, 0) with every level out to kLodRadius, against
+// the same chunks all meshed at full detail
+LodResult benchLod(const Options& opt, double meshTrianglesPerChunk)
+{
+    Terrain T(opt.seed, opt.extent);
+    std::vector<LodLevel> levels =
+            lodLevels(opt.viewRadius, kLodRadius, opt.extent);
+    LodResult res;
+    res.levels = levels.size();
+    res.chunks = 0;
+    res.lodTriangles = 0.0;
+    int side = 2 * levels.back().radius + 1;
+    int viewSide = 2 * opt.viewRadius + 1;
+    res.viewTriangles = meshTrianglesPerChunk * viewSide * viewSide;
+    res.fullTriangles = meshTrianglesPerChunk * side * side;
+    long nChunks = (long)side * side - (long)viewSide * viewSide;
+    for (size_t k = 1; k < levels.size(); k++) {
+        int r = levels[k].radius, inner = levels[k - 1].radius;
+        for (int j = -r; j <= r; j++) {
+            for (int i = -r; i <= r; i++) {
+                if (std::abs(i) <= inner && std::abs(j) <= inner) {
+                    continue;
+                }
+                glm::ivec2 c(i, j);
+                TicTocTimer timer = tic();
+                ChunkMesh mesh = T.getLodMesh(c, kHeights, levels[k].step);
+                res.build.add(toc(&timer), nChunks);
+                res.lodTriangles += mesh.faces.size();
+                res.chunks++;
+            }
+        }
+    }
+    return res;
+}
+
+struct BlockResult {
+    double bytes;        // Per chunk, as palette sections
+    double denseBytes;   // Per chunk, one byte per block of its sections
+    double sections;     // Per chunk
+    double uniform;      // Per chunk, sections of a single type
+    double buildMs;      // blocksFromColumns(), per chunk
+    double lookupNs;     // Per ChunkBlocks::get()
+    bool checksPassed;   // The timed lookups, against the mesher's volume
+};
+
+BlockResult benchBlocks(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    int side = 2 * opt.viewRadius + 1;
+    int nChunks = side * side;
+    std::vector<ChunkColumns> columns;
+    for (int j = 0; j < side; j++) {
+        for (int i = 0; i < side; i++) {
+            columns.push_back(T.getChunkColumns(
+                    glm::ivec2(i - opt.viewRadius, j - opt.viewRadius),
+                    kHeights));
+        }
+    }
+    BlockResult res;
+    res.bytes = res.denseBytes = res.sections = res.uniform = 0.0;
+    std::vector<ChunkBlocks> blocks;
+    TicTocTimer timer = tic();
+    for (const ChunkColumns& cols : columns) {
+        blocks.push_back(blocksFromColumns(cols));
+    }
+    res.buildMs = toc(&timer) * 1e3 / nChunks;
+    for (const ChunkBlocks& b : blocks) {
+        res.bytes += b.bytes();
+        res.denseBytes += (double)b.sectionCount() * BlockSection::kBlocks;
+        res.sections += b.sectionCount();
+        res.uniform += b.uniformSections();
+    }
+    res.bytes /= nChunks;
+    res.denseBytes /= nChunks;
+    res.sections /= nChunks;
+    res.uniform /= nChunks;
+
+    // Random blocks of one chunk, around its surface
+    const int n = 1 << 12;
+    const ChunkBlocks& b = blocks[nChunks / 2];
+    std::vector<glm::ivec3> points(n);
+    glm::ivec3 o = b.getOrigin();
+    for (int i = 0; i < n; i++) {
+        points[i] = o + glm::ivec3(rand() % opt.extent, rand() % 24,
+                                   rand() % opt.extent);
+    }
+    std::vector<uint8_t> got(n);
+    int reps = 200 * opt.iters;
+    timer = tic();
+    for (int r = 0; r < reps; r++) {
+        glm::ivec3 shift(0, r & 7, 0);
+        for (int i = 0; i < n; i++) {
+            got[i] = b.get(points[i] + shift);
+        }
+    }
+    res.lookupNs = toc(&timer) * 1e9 / ((double)reps * n);
+    // The last pass against the volume the mesher builds
+    glm::ivec2 c = columns[nChunks / 2].coords();
+    ChunkVolume volume = T.getChunkVolume(c, kHeights);
+    glm::ivec3 shift(0, (reps - 1) & 7, 0);
+    bool lookupsOk = true;
+    for (int i = 0; i < n; i++) {
+        glm::ivec3 l = points[i] + shift - volume.getOrigin();
+        lookupsOk = lookupsOk && got[i] == volume.get(l);
+    }
+    res.checksPassed = lookupsOk;
+    return res;
+}
+
+// Edits in one burst, as from one keypress
+constexpr int kEditBurst = 1000;
+
+struct EditResult {
+    Latency single;       // One edit: set, take dirty, remesh
+    double burstApplyMs;  // setBlock() for a whole burst
+    double burstRebuildMs; // Remeshing the chunks the burst dirtied
+    int burstChunks;      // Chunks rebuilt for the burst
+};
+
+EditResult benchEdits(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    ChunkRing ring(std::max(opt.viewRadius, 1));
+    fillRing(T, ring);
+    EditResult res;
+
+    // Break and restore one surface block in the middle of chunk (0, 0)
+    int center = ring.slotIndex(glm::ivec2(0, 0));
+    int n = opt.extent;
+    glm::ivec3 p = ring.getSlot(center).blockTypes.getOrigin() +
+                   glm::ivec3(n / 2, 0, n / 2);
+    p.y = ring.getSlot(center).columns.top[n / 2 + n * (n / 2)];
+    uint8_t type = ring.blockAt(p);
+    int reps = 4 * opt.iters;
+    for (int r = 0; r < reps; r++) {
+        TicTocTimer timer = tic();
+        ring.setBlock(p, r % 2 == 0 ? kAir : type);
+        for (int s : ring.takeDirty()) {
+            ring.remesh(s);
+        }
+        res.single.add(toc(&timer), reps);
+    }
+
+    // A burst: a cube of air carved around the corner of four chunks
+    int edge = (int)std::round(std::cbrt((double)kEditBurst));
+    glm::ivec3 corner(-edge / 2, p.y - edge / 2, -edge / 2);
+    TicTocTimer timer = tic();
+    for (int y = 0; y < edge; y++) {
+        for (int z = 0; z < edge; z++) {
+            for (int x = 0; x < edge; x++) {
+                ring.setBlock(corner + glm::ivec3(x, y, z), kAir);
+            }
+        }
+    }
+    res.burstApplyMs = toc(&timer) * 1e3;
+    std::vector<int> dirty = ring.takeDirty();
+    res.burstChunks = dirty.size();
+    for (int s : dirty) {
+        ring.remesh(s);
+    }
+    res.burstRebuildMs = toc(&timer) * 1e3;
+    return res;
+}
+
+// Rays per raycast() batch
+constexpr int kRayBatch = 4096;
+
+struct RaycastResult {
+    double raysPerSec;       // Batched DDA
+    double linearRaysPerSec; // Testing every block of the view
+    double hitFraction;      // Of the batch, rays that hit a block
+    int mismatches;          // Against the linear scan
+    bool checksPassed;       // Agreement and line of sight
+};
+
+// The nearest of cubes the ray enters within its reach, by slab tests
+RayHit linearRaycast(const std::vector<glm::vec3>& cubes, const Ray& ray)
+{
+    RayHit res;
+    glm::vec3 d = glm::normalize(ray.direction);
+    res.distance = ray.maxDistance;
+    for (const glm::vec3& c : cubes) {
+        float tNear = -1e30f, tFar = 1e30f;
+        int axis = -1;
+        for (int a = 0; a < 3; a++) {
+            if (d[a] == 0.0f) {
+                if (ray.origin[a] < c[a] || ray.origin[a] >= c[a] + 1.0f) {
+                    tFar = -1.0f;
+                }
+                continue;
+            }
+            float t0 = (c[a] - ray.origin[a]) / d[a];
+            float t1 = (c[a] + 1.0f - ray.origin[a]) / d[a];
+            if (t0 > t1) {
+                std::swap(t0, t1);
+            }
+            if (t0 > tNear) {
+                tNear = t0;
+                axis = a;
+            }
+            tFar = std::min(tFar, t1);
+        }
+        float t = std::max(tNear, 0.0f);
+        if (tFar < t || t > res.distance || (res.hit && t == res.distance)) {
+            continue;
+        }
+        res.hit = true;
+        res.block = glm::ivec3(c);
+        res.distance = t;
+        res.face = glm::ivec3(0);
+        if (tNear > 0.0f) {
+            res.face[axis] = d[axis] > 0.0f ? -1 : 1;
+        }
+    }
+    return res;
+}
+
+RaycastResult benchRaycast(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    ChunkRing ring(std::max(opt.viewRadius, 1));
+    fillRing(T, ring);
+    int n = opt.extent;
+
+    // From a few blocks above the terrain around chunk (0, 0), mostly
+    // looking down, out to one chunk
+    std::vector<Ray> rays(kRayBatch);
+    srand(opt.seed);
+    auto uniform = []() { return rand() / (float)RAND_MAX; };
+    for (Ray& ray : rays) {
+        ray.origin = glm::vec3((2.0f * uniform() - 1.0f) * n, 1.0f +
+                               5.0f * uniform(), (2.0f * uniform() - 1.0f) * n);
+        ray.direction = glm::vec3(2.0f * uniform() - 1.0f,
+                                  -uniform(), 2.0f * uniform() - 1.0f);
+        ray.maxDistance = n;
+    }
+    std::vector<RayHit> hits(kRayBatch);
+    RaycastResult res;
+    int reps = 10 * opt.iters;
+    TicTocTimer timer = tic();
+    for (int r = 0; r < reps; r++) {
+        raycast(ring, rays.data(), hits.data(), kRayBatch);
+    }
+    res.raysPerSec = (double)reps * kRayBatch / toc(&timer);
+    res.hitFraction = 0.0;
+    for (const RayHit& hit : hits) {
+        res.hitFraction += hit.hit / (double)kRayBatch;
+    }
+
+    // The linear scan is slow; a few hundred rays are enough
+    std::vector<glm::vec3> cubes = ring.offsetsNear(glm::ivec2(0, 0),
+                                                    ring.getRadius());
+    const int linearRays = 256;
+    std::vector<RayHit> linear(linearRays);
+    timer = tic();
+    for (int i = 0; i < linearRays; i++) {
+        linear[i] = linearRaycast(cubes, rays[i]);
+    }
+    res.linearRaysPerSec = linearRays / toc(&timer);
+
+    res.mismatches = 0;
+    res.checksPassed = true;
+    for (int i = 0; i < linearRays; i++) {
+        const RayHit& a = hits[i];
+        const RayHit& b = linear[i];
+        bool same = a.hit == b.hit &&
+                    (!a.hit || (a.block == b.block && a.face == b.face &&
+                                fabs(a.distance - b.distance) < 1e-3f));
+        res.mismatches += !same;
+        if (a.hit && a.distance > 0.01f) {
+            glm::vec3 d = glm::normalize(rays[i].direction);
+            glm::vec3 o = rays[i].origin;
+            res.checksPassed &=
+                    lineOfSight(ring, o, o + (a.distance - 0.01f) * d) &&
+                    !lineOfSight(ring, o, o + (a.distance + 0.01f) * d);
+        }
+    }
+    res.checksPassed &= res.mismatches == 0;
+    return res;
+}
+
+struct TimestepResult {
+    double fixedSpread;    // Furthest apart two frame rates leave the eye
+    double variableSpread; // The same, stepping physics once per frame
+    bool checksPassed;     // Fixed ticks land on the same eye
+};
+
+// The camera after falling onto the terrain and walking forward for
+// seconds of simulation, run in fixed ticks over frames of the given
+// lengths (cycled)
+glm::vec3 simulateFixed(const Chunk& chunk, const CollisionGrid& grid,
+                        const std::vector<double>& frames, double seconds)
+{
+    Camera camera;
+    FixedTimestep clock(kTickRate, 1 << 20);
+    long ticks = std::lround(seconds * kTickRate);
+    for (size_t f = 0; clock.tickCount() < ticks; f++) {
+        int n = clock.advance(frames[f % frames.size()]);
+        long first = clock.tickCount() - n;
+        for (int k = 0; k < n && first + k < ticks; k++) {
+            camera.begin_tick();
+            camera.update_physics(clock.getTickSeconds(), chunk, grid);
+            camera.ws_walk_cam(1, grid);
+        }
+    }
+    return camera.getEye();
+}
+
+// The same stepping physics and input once per frame, as the render loop
+// used to
+glm::vec3 simulateVariable(const Chunk& chunk, const CollisionGrid& grid,
+                           const std::vector<double>& frames, double seconds)
+{
+    Camera camera;
+    double t = 0.0;
+    for (size_t f = 0; t + 1e-9 < seconds; f++) {
+        double dt = std::min(frames[f % frames.size()], seconds - t);
+        camera.update_physics(dt, chunk, grid);
+        camera.ws_walk_cam(1, grid);
+        t += dt;
+    }
+    return camera.getEye();
+}
+
+TimestepResult benchTimestep(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    T.setViewRadius(opt.viewRadius);
+    CollisionGrid grid;
+    grid.build(T.getOffsetsForRender(T.getChunkCenter(glm::ivec2(0, 0)),
+                                     kHeights));
+    Chunk chunk = T.getChunk(glm::ivec2(0, 0));
+    // 144, 60 and 30 Hz, and frames of 4 to 40 ms
+    std::vector<std::vector<double>> rates = {
+            {1.0 / 144}, {1.0 / 60}, {1.0 / 30}, {}};
+    srand(opt.seed);
+    for (int f = 0; f < 97; f++) {
+        rates.back().push_back(0.004 + 0.036 * rand() / RAND_MAX);
+    }
+    const double seconds = 3.0;
+    std::vector<glm::vec3> fixed, variable;
+    for (const std::vector<double>& frames : rates) {
+        fixed.push_back(simulateFixed(chunk, grid, frames, seconds));
+        variable.push_back(simulateVariable(chunk, grid, frames, seconds));
+    }
+    TimestepResult res;
+    res.fixedSpread = res.variableSpread = 0.0;
+    for (size_t i = 0; i < rates.size(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            res.fixedSpread = std::max(
+                    res.fixedSpread, (double)glm::length(fixed[i] - fixed[j]));
+            res.variableSpread = std::max(
+                    res.variableSpread,
+                    (double)glm::length(variable[i] - variable[j]));
+        }
+    }
+    res.checksPassed = res.fixedSpread == 0.0;
+    return res;
+}
+
+// Entities per tick, and the wall time a tick of them may take: a quarter
+// of a tick at kTickRate
+constexpr int kEntityCount = 10000;
+constexpr double kEntityBudgetMs = 1000.0 / kTickRate / 4;
+// The CMake build type, reported with the budget verdict since only an
+// optimized build is expected to meet it
+#ifdef TERRAIN_BUILD_TYPE
+const char* const kBuildType = TERRAIN_BUILD_TYPE[0] ? TERRAIN_BUILD_TYPE
+                                                     : "unoptimized";
+#else
+const char* const kBuildType = "unknown";
+#endif
+struct EntityResult {
+    int threads;        // Hardware threads
+    Latency serial;     // A tick of kEntityCount entities on one thread
+    Latency parallel;   // The same on every hardware thread
+    int chunks;         // Chunks the entities were spread over
+    bool withinBudget;  // The parallel mean fits in kEntityBudgetMs
+};
+
+double tickEntities(EntitySystem& entities, const ChunkRing& ring,
+                    Latency& latency)
+{
+    const int ticks = 4 * kTickRate;
+    for (int t = 0; t < ticks; t++) {
+        TicTocTimer timer = tic();
+        entities.tick(1.0 / kTickRate, ring);
+        latency.add(toc(&timer), ticks);
+    }
+    return latency.mean;
+}
+
+EntityResult benchEntities(const Options& opt)
+{
+    Terrain T(opt.seed, opt.extent);
+    ChunkRing ring(std::max(opt.viewRadius, 1));
+    fillRing(T, ring);
+    EntityResult res;
+    res.threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    EntitySystem serial(1), parallel(res.threads);
+    spawnEntities(serial, ring, opt.extent, kEntityCount, opt.seed);
+    spawnEntities(parallel, ring, opt.extent, kEntityCount, opt.seed);
+    tickEntities(serial, ring, res.serial);
+    tickEntities(parallel, ring, res.parallel);
+    res.chunks = parallel.chunkCount();
+    res.withinBudget = res.parallel.mean * 1e3 <= kEntityBudgetMs;
+    return res;
+}
+
+struct ProfilerResult {
+    double disabledNs; // Per ScopedTimer
+    double enabledNs;  // Per ScopedTimer, frame sums only
+    double tracingNs;  // Per ScopedTimer, also keeping trace events
+};
+
+double timerCost(int n)
+{
+    TicTocTimer timer = tic();
+    for (int i = 0; i < n; i++) {
+        ScopedTimer t(kZoneDraw);
+    }
+    return toc(&timer) * 1e9 / n;
+}
+
+// Runs last: the process-wide profiler cannot be turned off again
+ProfilerResult benchProfiler(const Options& opt)
+{
+    const int n = 200000 * opt.iters;
+    ProfilerResult res;
+    res.disabledNs = timerCost(n);
+    profiler().enable(false);
+    profiler().beginFrame();
+    res.enabledNs = timerCost(n);
+    profiler().enable(true);
+    profiler().beginFrame();
+    res.tracingNs = timerCost(n);
+    return res;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opt = parseArgs(argc, argv);
+
+    double chunkRate = chunksPerSecond(opt);
+    std::vector<KernelResult> kernels = benchKernels(opt);
+    std::vector<OctaveResult> octaves = benchOctaves(opt);
+    Latency cold, warm, seams, legacySeams;
+    size_t fillers = 0, legacyFillers = 0, instances = 0;
+    benchOffsets(opt, cold, warm, instances);
+    benchSeams(opt, seams, legacySeams, fillers, legacyFillers);
+    StreamResult stream = benchStreaming(opt);
+    MeshResult meshing = benchMeshing(opt);
+    CollisionResult collision = benchCollision(opt);
+    RegionResult regions = benchRegions(opt);
+    size_t textureBytes = 0;
+    Latency bake = benchBlockTextures(opt, textureBytes);
+    CullResult culling = benchCulling(opt);
+    LodResult lod = benchLod(opt, meshing.meshTriangles);
+    BlockResult blocks = benchBlocks(opt);
+    EditResult edits = benchEdits(opt);
+    RaycastResult rays = benchRaycast(opt);
+    TimestepResult timestep = benchTimestep(opt);
+    EntityResult entities = benchEntities(opt);
+    ProfilerResult prof = benchProfiler(opt);
+    long rss = peakRss();
+
+    if (opt.json) {
+        printf("{\n");
+        printf("  \"radius\": %d,\n  \"view_radius\": %d,\n"
+               "  \"extent\": %d,\n  \"iters\": %d,\n",
+               opt.radius, opt.viewRadius, opt.extent, opt.iters);
+        printf("  \"chunks_per_sec\": %.2f,\n", chunkRate);
+        printf("  \"noise\": [\n");
+        for (size_t i = 0; i < kernels.size(); i++) {
+            const KernelResult& k = kernels[i];
+            printf("    {\"kernel\": \"%s\", \"ns_per_sample\": %.3f, "
+                   "\"samples_per_sec\": %.0f, \"max_error\": %.3g}%s\n",
+                   noiseKernelName(k.kernel), k.nsPerSample, k.samplesPerSec,
+                   k.maxError, i + 1 < kernels.size() ? "," : "");
+        }
+        printf("  ],\n");
+        printf("  \"fractal_noise\": [\n");
+        for (size_t i = 0; i < octaves.size(); i++) {
+            const OctaveResult& o = octaves[i];
+            printf("    {\"octaves\": %d, \"ns_per_sample\": %.3f, "
+                   "\"ns_per_octave\": %.3f}%s\n",
+                   o.octaves, o.nsPerSample, o.nsPerSample / o.octaves,
+                   i + 1 < octaves.size() ? "," : "");
+        }
+        printf("  ],\n");
+        printf("  \"offsets_cold_ms\": {\"mean\": %.3f, \"max\": %.3f},\n",
+               cold.mean * 1e3, cold.max * 1e3);
+        printf("  \"offsets_warm_ms\": {\"mean\": %.3f, \"max\": %.3f},\n",
+               warm.mean * 1e3, warm.max * 1e3);
+        printf("  \"seams_ms\": {\"mean\": %.3f, \"max\": %.3f},\n",
+               seams.mean * 1e3, seams.max * 1e3);
+        printf("  \"seam_fillers\": %zu,\n", fillers);
+        printf("  \"legacy_seams_ms\": {\"mean\": %.3f, \"max\": %.3f},\n",
+               legacySeams.mean * 1e3, legacySeams.max * 1e3);
+        printf("  \"legacy_seam_fillers\": %zu,\n", legacyFillers);
+        printf("  \"instances\": %zu,\n", instances);
+        printf("  \"mesh\": {\"cube_triangles\": %.0f, "
+               "\"mesh_triangles\": %.0f, \"exposed_faces\": %.0f, "
+               "\"build_ms\": %.3f, \"kib\": %.1f},\n",
+               meshing.cubeTriangles, meshing.meshTriangles,
+               meshing.exposedFaces, meshing.build.mean * 1e3,
+               meshing.meshBytes / 1024);
+        printf("  \"stream\": {\"ring_kib\": %.1f, \"full_kib\": %.1f, "
+               "\"chunks_ms\": %.3f, \"column_kib\": %.1f, "
+               "\"expanded_kib\": %.1f},\n",
+               stream.ringBytes / 1024, stream.fullBytes / 1024,
+               stream.chunks.mean * 1e3, stream.columnBytes / 1024.0,
+               stream.expandedBytes / 1024.0);
+        printf("  \"collision\": {\"linear_ns\": %.1f, \"grid_ns\": %.1f, "
+               "\"build_ms\": %.3f, \"mismatches\": %d},\n",
+               collision.linearNs, collision.gridNs, collision.buildMs,
+               collision.mismatches);
+        printf("  \"regions\": {\"generate_ms\": %.3f, \"load_ms\": %.3f, "
+               "\"file_kib\": %.1f, \"mismatches\": %d},\n",
+               regions.generate.mean * 1e3, regions.load.mean * 1e3,
+               regions.fileBytes / 1024.0, regions.mismatches);
+        printf("  \"block_textures\": {\"bake_ms\": %.3f, \"kib\": %.1f},\n",
+               bake.mean * 1e3, textureBytes / 1024.0);
+        printf("  \"culling\": {\"visible\": %.1f, \"culled\": %.1f, "
+               "\"ns_per_chunk\": %.1f},\n",
+               culling.visible, culling.culled, culling.nsPerChunk);
+        printf("  \"lod\": {\"levels\": %d, \"chunks\": %ld, "
+               "\"lod_triangles\": %.0f, \"view_triangles\": %.0f, "
+               "\"full_triangles\": %.0f, \"build_ms\": %.3f},\n",
+               lod.levels, lod.chunks, lod.lodTriangles, lod.viewTriangles,
+               lod.fullTriangles, lod.build.mean * 1e3);
+        printf("  \"blocks\": {\"kib\": %.2f, \"dense_kib\": %.2f, "
+               "\"sections\": %.1f, \"uniform_sections\": %.1f, "
+               "\"build_ms\": %.3f, \"lookup_ns\": %.2f, "
+               "\"checks_passed\": %s},\n",
+               blocks.bytes / 1024, blocks.denseBytes / 1024, blocks.sections,
+               blocks.uniform, blocks.buildMs, blocks.lookupNs,
+               blocks.checksPassed ? "true" : "false");
+        printf("  \"edits\": {\"single_ms\": %.3f, \"burst\": %d, "
+               "\"burst_apply_ms\": %.3f, \"burst_rebuild_ms\": %.3f, "
+               "\"burst_chunks\": %d},\n",
+               edits.single.mean * 1e3, kEditBurst, edits.burstApplyMs,
+               edits.burstRebuildMs, edits.burstChunks);
+        printf("  \"raycast\": {\"rays_per_sec\": %.0f, "
+               "\"linear_rays_per_sec\": %.0f, \"hit_fraction\": %.3f, "
+               "\"mismatches\": %d, \"checks_passed\": %s},\n",
+               rays.raysPerSec, rays.linearRaysPerSec, rays.hitFraction,
+               rays.mismatches,
+               rays.checksPassed ? "true" : "false");
+        printf("  \"timestep\": {\"fixed_spread\": %.4f, "
+               "\"variable_spread\": %.4f, \"checks_passed\": %s},\n",
+               timestep.fixedSpread, timestep.variableSpread,
+               timestep.checksPassed ? "true" : "false");
+        printf("  \"entities\": {\"count\": %d, \"threads\": %d, "
+               "\"chunks\": %d, \"serial_ms\": {\"mean\": %.3f, "
+               "\"max\": %.3f}, \"parallel_ms\": {\"mean\": %.3f, "
+               "\"max\": %.3f}, \"budget_ms\": %.3f, "
+               "\"within_budget\": %s, \"build_type\": \"%s\"},\n",
+               kEntityCount, entities.threads, entities.chunks,
+               entities.serial.mean * 1e3, entities.serial.max * 1e3,
+               entities.parallel.mean * 1e3, entities.parallel.max * 1e3,
+               kEntityBudgetMs, entities.withinBudget ? "true" : "false",
+               kBuildType);
+        printf("  \"profiler_ns\": {\"disabled\": %.1f, \"enabled\": %.1f, "
+               "\"tracing\": %.1f},\n",
+               prof.disabledNs, prof.enabledNs, prof.tracingNs);
+        printf("  \"peak_rss_bytes\": %ld\n", rss);
+        printf("}\n");
+    } else {
+        printf("radius %d, view radius %d, extent %d, %d iterations\n",
+               opt.radius, opt.viewRadius, opt.extent, opt.iters);
+        printf("chunk generation:      %.1f chunks/s\n", chunkRate);
+        for (const KernelResult& k : kernels) {
+            printf("noise (%-6s):        %.3f ns/sample, %.3g samples/s, "
+                   "max error %.3g%s\n",
+                   noiseKernelName(k.kernel), k.nsPerSample, k.samplesPerSec,
+                   k.maxError,
+                   k.maxError > 0.0 ? " (NOT BIT-EXACT)" : "");
+        }
+        for (const OctaveResult& o : octaves) {
+            printf("fractal noise (%d):     %.3f ns/sample, %.3f ns per "
+                   "octave\n",
+                   o.octaves, o.nsPerSample, o.nsPerSample / o.octaves);
+        }
+        printf("getOffsetsForRender:   cold %.3f ms, warm %.3f ms "
+               "(max %.3f ms)\n",
+               cold.mean * 1e3, warm.mean * 1e3, warm.max * 1e3);
+        printf("fixNeighborGaps:       %.3f ms (max %.3f ms), %zu fillers\n",
+               seams.mean * 1e3, seams.max * 1e3, fillers);
+        printf("  before reserve:      %.3f ms (max %.3f ms), %zu fillers\n",
+               legacySeams.mean * 1e3, legacySeams.max * 1e3, legacyFillers);
+        printf("instances drawn:       %zu\n", instances);
+        printf("triangles per chunk:   %.0f as cubes, %.0f meshed (%.0f "
+               "exposed faces), %.3f ms to mesh\n",
+               meshing.cubeTriangles, meshing.meshTriangles,
+               meshing.exposedFaces, meshing.build.mean * 1e3);
+        printf("mesh size per chunk:   %.1f KiB\n", meshing.meshBytes / 1024);
+        printf("per crossing:          %.1f KiB streamed (full view %.1f KiB),"
+               " %.3f ms to build\n",
+               stream.ringBytes / 1024, stream.fullBytes / 1024,
+               stream.chunks.mean * 1e3);
+        printf("resident view:         %.1f KiB as columns, %.1f KiB as "
+               "offsets and seeds\n",
+               stream.columnBytes / 1024.0, stream.expandedBytes / 1024.0);
+        printf("collision query:       linear %.1f ns, grid %.1f ns "
+               "(build %.3f ms)%s\n",
+               collision.linearNs, collision.gridNs, collision.buildMs,
+               collision.mismatches ? " (MISMATCH)" : "");
+        printf("chunk from regions:    %.3f ms (generated %.3f ms), "
+               "%.1f KiB of files%s\n",
+               regions.load.mean * 1e3, regions.generate.mean * 1e3,
+               regions.fileBytes / 1024.0,
+               regions.mismatches ? " (MISMATCH)" : "");
+        printf("block textures:        %.3f ms to bake (max %.3f ms), "
+               "%.1f KiB\n",
+               bake.mean * 1e3, bake.max * 1e3, textureBytes / 1024.0);
+        printf("frustum culling:       %.1f chunks drawn, %.1f culled per "
+               "view, %.1f ns per chunk\n",
+               culling.visible, culling.culled, culling.nsPerChunk);
+        printf("levels of detail:      %d levels to radius %d: %.0f "
+               "triangles (%.0f in view, %.0f beyond in %ld chunks), %.0f at "
+               "full detail; %.3f ms per chunk\n",
+               lod.levels, kLodRadius, lod.viewTriangles + lod.lodTriangles,
+               lod.viewTriangles, lod.lodTriangles, lod.chunks,
+               lod.fullTriangles, lod.build.mean * 1e3);
+        printf("block sections:        %.2f KiB per chunk (%.2f KiB dense), "
+               "%.1f sections (%.1f uniform), %.3f ms to build, %.2f ns per "
+               "lookup%s\n",
+               blocks.bytes / 1024, blocks.denseBytes / 1024, blocks.sections,
+               blocks.uniform, blocks.buildMs, blocks.lookupNs,
+               blocks.checksPassed ? "" : " (BLOCK CHECK FAILED)");
+        printf("block edits:           %.3f ms edit to rebuilt mesh (max "
+               "%.3f ms); %d edits in %.3f ms, %d chunks rebuilt in %.3f "
+               "ms\n",
+               edits.single.mean * 1e3, edits.single.max * 1e3, kEditBurst,
+               edits.burstApplyMs, edits.burstChunks, edits.burstRebuildMs);
+        printf("voxel raycast:         %.3g rays/s in batches of %d (%.0f%% "
+               "hit), %.3g rays/s by linear scan%s\n",
+               rays.raysPerSec, kRayBatch, 100.0 * rays.hitFraction,
+               rays.linearRaysPerSec,
+               rays.checksPassed ? "" : " (RAYCAST CHECK FAILED)");
+        printf("camera physics:        eye %.4f blocks apart across frame "
+               "rates with fixed %.0f Hz ticks, %.4f stepping per frame%s\n",
+               timestep.fixedSpread, kTickRate, timestep.variableSpread,
+               timestep.checksPassed ? "" : " (TIMESTEP CHECK FAILED)");
+        printf("entities:              %d over %d chunks, %.3f ms per tick "
+               "on %d threads (max %.3f ms, budget %.2f ms), %.3f ms on one%s"
+               " [%s build]\n",
+               kEntityCount, entities.chunks, entities.parallel.mean * 1e3,
+               entities.threads, entities.parallel.max * 1e3, kEntityBudgetMs,
+               entities.serial.mean * 1e3,
+               entities.withinBudget ? "" : " (OVER BUDGET)", kBuildType);
+        printf("scoped timer:          %.1f ns off, %.1f ns on, %.1f ns "
+               "tracing\n",
+               prof.disabledNs, prof.enabledNs, prof.tracingNs);
+        printf("peak RSS:              %.1f MiB\n", rss / 1048576.0);
+    }
+
+    bool passed = collision.mismatches == 0 && regions.mismatches == 0 &&
+                  blocks.checksPassed && rays.checksPassed &&
+                  timestep.checksPassed;
+    for (const KernelResult& k : kernels) {
+        passed = passed && k.maxError == 0.0;
+    }
+    if (!passed) {
+        fprintf(stderr, "%s: checks failed\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#ifndef TERRAIN_FIXTURES_H
+#define TERRAIN_FIXTURES_H
+
+#include <cstdlib>
+
+#include <glm/glm.hpp>
+#include "Terrain.h"
+#include "chunkblocks.h"
+#include "chunkring.h"
+#include "entities.h"
+
+/* Scenes terrain_bench and terrain_tests both set up. */
+
+// Simulation ticks per second, as in the render loop
+constexpr double kTickRate = 60.0;
+
+// The view around chunk (0, 0), with blocks
+inline void fillRing(Terrain& T, ChunkRing& ring)
+{
+    for (const glm::ivec2& c : ring.recenter(glm::ivec2(0, 0))) {
+        ChunkData chunk;
+        chunk.coords = c;
+        chunk.columns = T.getChunkColumns(c, Terrain::kRenderHeights);
+        chunk.blocks = blocksFromColumns(chunk.columns);
+        ring.store(chunk);
+    }
+}
+
+// n entities dropped over the ring's view (centered on chunk (0, 0)) up to
+// half a chunk from its edge, one in four a mob, sliding up to 2 blocks/s
+// sideways
+inline void spawnEntities(EntitySystem& entities, const ChunkRing& ring,
+                          int extent, int n, unsigned seed)
+{
+    srand(seed);
+    auto uniform = [] { return 2.0f * rand() / RAND_MAX - 1.0f; };
+    float reach = ring.getRadius() * extent;
+    for (int i = 0; i < n; i++) {
+        glm::vec3 p(extent / 2 + reach * uniform(), 10.0f + 8.0f * uniform(),
+                    extent / 2 + reach * uniform());
+        glm::vec3 v(2.0f * uniform(), 0.0f, 2.0f * uniform());
+        glm::vec3 size = i % 4 == 0 ? glm::vec3(0.6f, 1.8f, 0.6f)
+                                    : glm::vec3(0.25f + 0.05f * (i % 3));
+        entities.spawn(p, size, v);
+    }
+}
+
+#endif
@@ -0,0 +1,263 @@
+// Offline world generation. Builds the columns of every chunk in a rectangle
+// on all cores and writes them to region files that minecraft --world reads.
+//
+//   terrain_pregen --world DIR [--seed S] [--min X Z] [--max X Z]
+//                  [--threads T]
+//
+// --min and --max are inclusive chunk coordinates (default -16..15 on both
+// axes). An existing world's seed is kept; otherwise --seed (default 1) is
+// used and saved with the regions. Reports throughput and how busy each
+// thread was.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "Terrain.h"
+#include "regionfile.h"
+#include "tictoc.h"
+
+namespace {
+struct Options {
+    std::string world;
+    uint64_t seed = 1;
+    glm::ivec2 min = glm::ivec2(-16, -16);
+    glm::ivec2 max = glm::ivec2(15, 15);
+    int threads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s --world DIR [--seed S] [--min X Z] [--max X Z] "
+            "[--threads T]\n",
+            argv0);
+    exit(EXIT_FAILURE);
+}
+
+Options parseArgs(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--world" && i + 1 < argc) {
+            opt.world = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            opt.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--min" && i + 2 < argc) {
+            opt.min.x = atoi(argv[++i]);
+            opt.min.y = atoi(argv[++i]);
+        } else if (arg == "--max" && i + 2 < argc) {
+            opt.max.x = atoi(argv[++i]);
+            opt.max.y = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.world.empty() || opt.threads < 1 || opt.max.x < opt.min.x ||
+        opt.max.y < opt.min.y) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+// Chunks of one region that fall inside the area, collected until the last
+// of its rows is done and then written out together
+struct RegionBatch {
+    glm::ivec2 region;
+    std::mutex mutex;
+    std::vector<ChunkColumns> chunks;
+    std::atomic<int> rowsLeft{0};
+};
+
+// One unit of work: a row of chunks within one region
+struct Task {
+    RegionBatch* batch;
+    int z, x0, x1; // Chunks (x0..x1, z), inclusive
+};
+
+/* A thread's share of the tasks. The owner takes from the front, in the
+   order the tasks were laid out, so consecutive rows reuse its Terrain's
+   cached neighbor noise; idle threads steal from the back, the work the
+   owner would reach last. Nothing adds tasks once the workers start, so a
+   thread that finds every queue empty is done. */
+class TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+
+    public:
+    // Only before the workers start
+    void push(const Task& task) { tasks.push_back(task); }
+
+    bool pop(Task& task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+    bool steal(Task& task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+};
+
+struct ThreadStats {
+    double generating = 0.0; // Seconds spent building chunks
+    double writing = 0.0;    // Seconds spent writing regions
+    long chunks = 0;
+    long tasks = 0;
+    long stolen = 0;
+};
+
+void worker(int id, const Options& opt, RegionStore& store,
+            std::vector<std::unique_ptr<TaskQueue>>& queues,
+            ThreadStats& stats, std::atomic<bool>& failed)
+{
+    // Each thread keeps its own caches; Terrain is safe to share, but
+    // private caches never wait on another thread's lock
+    Terrain T(opt.seed);
+    int n = (int)queues.size();
+    for (;;) {
+        Task task;
+        bool found = queues[id]->pop(task);
+        for (int k = 1; !found && k < n; k++) {
+            found = queues[(id + k) % n]->steal(task);
+            stats.stolen += found;
+        }
+        if (!found) {
+            return;
+        }
+
+        TicTocTimer timer = tic();
+        std::vector<ChunkColumns> row;
+        row.reserve(task.x1 - task.x0 + 1);
+        for (int x = task.x0; x <= task.x1; x++) {
+            row.push_back(T.getChunkColumns(glm::ivec2(x, task.z),
+                                            Terrain::kRenderHeights));
+        }
+        stats.generating += toc(&timer);
+        stats.chunks += row.size();
+        stats.tasks++;
+
+        RegionBatch& batch = *task.batch;
+        {
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            for (ChunkColumns& c : row) {
+                batch.chunks.push_back(std::move(c));
+            }
+        }
+        if (--batch.rowsLeft == 0) {
+            // Every other row is in; nobody else touches the batch now
+            timer = tic();
+            if (!store.save(batch.chunks)) {
+                failed = true;
+            }
+            std::vector<ChunkColumns>().swap(batch.chunks);
+            stats.writing += toc(&timer);
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opt = parseArgs(argc, argv);
+    RegionStore::loadSeed(opt.world, opt.seed);
+    Terrain probe(opt.seed);
+    RegionStore store(opt.world, opt.seed, probe.getChunkExtent(),
+                      Terrain::kRenderHeights);
+
+    // One batch per region the area touches, one task per row of each
+    glm::ivec2 rMin = RegionStore::regionOf(opt.min);
+    glm::ivec2 rMax = RegionStore::regionOf(opt.max);
+    std::vector<std::unique_ptr<RegionBatch>> batches;
+    std::vector<Task> tasks;
+    for (int rz = rMin.y; rz <= rMax.y; rz++) {
+        for (int rx = rMin.x; rx <= rMax.x; rx++) {
+            glm::ivec2 r(rx, rz);
+            glm::ivec2 lo = glm::max(r * RegionFile::kRegionChunks, opt.min);
+            glm::ivec2 hi = glm::min(r * RegionFile::kRegionChunks +
+                                             RegionFile::kRegionChunks - 1,
+                                     opt.max);
+            batches.emplace_back(new RegionBatch);
+            RegionBatch* batch = batches.back().get();
+            batch->region = r;
+            batch->rowsLeft = hi.y - lo.y + 1;
+            batch->chunks.reserve((hi.x - lo.x + 1) * (hi.y - lo.y + 1));
+            for (int z = lo.y; z <= hi.y; z++) {
+                tasks.push_back(Task{batch, z, lo.x, hi.x});
+            }
+        }
+    }
+
+    // Deal out contiguous runs of tasks so each thread starts on its own
+    // regions
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    for (int t = 0; t < opt.threads; t++) {
+        queues.emplace_back(new TaskQueue);
+        size_t first = tasks.size() * t / opt.threads;
+        size_t last = tasks.size() * (t + 1) / opt.threads;
+        for (size_t i = first; i < last; i++) {
+            queues.back()->push(tasks[i]);
+        }
+    }
+
+    std::vector<ThreadStats> stats(opt.threads);
+    std::atomic<bool> failed(false);
+    TicTocTimer timer = tic();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; t++) {
+        threads.emplace_back(worker, t, std::cref(opt), std::ref(store),
+                             std::ref(queues), std::ref(stats[t]),
+                             std::ref(failed));
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    double seconds = toc(&timer);
+    if (failed || !store.saveSeed()) {
+        fprintf(stderr, "could not write the world to %s\n",
+                opt.world.c_str());
+        return EXIT_FAILURE;
+    }
+
+    long chunks = 0;
+    for (const ThreadStats& s : stats) {
+        chunks += s.chunks;
+    }
+    glm::ivec2 size = opt.max - opt.min + 1;
+    printf("%ld chunks (%dx%d) in %zu regions, seed %llu: %.2f s, "
+           "%.0f chunks/s on %d threads\n",
+           chunks, size.x, size.y, batches.size(),
+           (unsigned long long)opt.seed, seconds, chunks / seconds,
+           opt.threads);
+    for (int t = 0; t < opt.threads; t++) {
+        const ThreadStats& s = stats[t];
+        printf("thread %2d: %5.1f%% generating, %5.1f%% writing, "
+               "%ld chunks, %ld tasks (%ld stolen)\n",
+               t, 100.0 * s.generating / seconds,
+               100.0 * s.writing / seconds, s.chunks, s.tasks, s.stolen);
+    }
+    return 0;
+}
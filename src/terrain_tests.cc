@@ -0,0 +1,881 @@
+// Headless terrain tests. Needs no GL context, so it runs on CI boxes.
+//
+//   terrain_tests [TEST...]
+//
+// Runs the named tests, or all of them, and exits non-zero if any fails.
+// Each test is also registered with CTest under its name.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Terrain.h"
+#include "camera.h"
+#include "chunkblocks.h"
+#include "chunkring.h"
+#include "collisiongrid.h"
+#include "entities.h"
+#include "fixedtimestep.h"
+#include "fractalnoise.h"
+#include "frustum.h"
+#include "mesher.h"
+#include "noise.h"
+#include "profiler.h"
+#include "regionfile.h"
+#include "terrain_fixtures.h"
+#include "terrainworkers.h"
+#include "tictoc.h"
+
+namespace {
+const glm::vec2& kHeights = Terrain::kRenderHeights;
+const uint64_t kSeed = 1;
+
+// Chunks on both sides of the origin and far from it
+std::vector<glm::ivec2> sampleChunks()
+{
+    std::vector<glm::ivec2> chunks;
+    for (int j = -2; j <= 2; j++) {
+        for (int i = -2; i <= 2; i++) {
+            chunks.emplace_back(i, j);
+        }
+    }
+    chunks.emplace_back(1000, -77);
+    chunks.emplace_back(-4321, 4321);
+    return chunks;
+}
+
+template <typename T>
+bool sameBytes(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() &&
+           (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+bool sameChunk(const ChunkData& a, const ChunkData& b)
+{
+    return a.coords == b.coords && a.columns.origin == b.columns.origin &&
+           a.columns.texSeed == b.columns.texSeed &&
+           sameBytes(a.columns.top, b.columns.top) &&
+           sameBytes(a.columns.depth, b.columns.depth) &&
+           a.mesh.exposedFaces == b.mesh.exposedFaces &&
+           sameBytes(a.mesh.vertices, b.mesh.vertices) &&
+           sameBytes(a.mesh.normals, b.mesh.normals) &&
+           sameBytes(a.mesh.faces, b.mesh.faces);
+}
+
+// Columns and meshes of chunks, in the order given, on a fresh Terrain;
+// returned in sampleChunks() order
+std::vector<ChunkData> generateInOrder(const std::vector<int>& order)
+{
+    std::vector<glm::ivec2> chunks = sampleChunks();
+    std::vector<ChunkData> res(chunks.size());
+    Terrain T(kSeed);
+    for (int k : order) {
+        res[k].coords = chunks[k];
+        res[k].columns = T.getChunkColumns(chunks[k], kHeights);
+        res[k].mesh = T.getChunkMesh(chunks[k], kHeights);
+    }
+    return res;
+}
+
+// The same through TerrainWorkers, in whatever order its threads finish
+std::vector<ChunkData> generateOnWorkers(int nThreads)
+{
+    std::vector<glm::ivec2> chunks = sampleChunks();
+    std::vector<ChunkData> res(chunks.size());
+    Terrain T(kSeed);
+    TerrainWorkers workers(T, kHeights, nThreads, true);
+    workers.requestChunks(chunks);
+    for (size_t done = 0; done < chunks.size();) {
+        ChunkData chunk;
+        if (!workers.pollChunk(chunk)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        size_t k = std::find(chunks.begin(), chunks.end(), chunk.coords) -
+                   chunks.begin();
+        if (k < chunks.size()) {
+            res[k] = std::move(chunk);
+            done++;
+        }
+    }
+    return res;
+}
+
+// A chunk is the same bytes whatever was generated before it and on
+// however many threads: forward, reversed and shuffled on one Terrain, and
+// through one and four workers
+bool checkDeterminism()
+{
+    std::vector<int> order(sampleChunks().size());
+    for (size_t k = 0; k < order.size(); k++) {
+        order[k] = k;
+    }
+    std::vector<ChunkData> reference = generateInOrder(order);
+    std::vector<std::vector<ChunkData>> runs;
+    std::reverse(order.begin(), order.end());
+    runs.push_back(generateInOrder(order));
+    std::shuffle(order.begin(), order.end(), std::mt19937(kSeed));
+    runs.push_back(generateInOrder(order));
+    runs.push_back(generateOnWorkers(1));
+    runs.push_back(generateOnWorkers(4));
+    for (const std::vector<ChunkData>& run : runs) {
+        for (size_t k = 0; k < reference.size(); k++) {
+            if (!sameChunk(run[k], reference[k])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Every noise kernel the CPU has gives the same noise and builds the same
+// chunks, to the byte. Heights are rounded from the noise, so a kernel that
+// is off by an ulp mostly builds the same chunks; the noise itself shows it.
+bool checkNoiseKernels()
+{
+    std::vector<glm::ivec2> chunks = sampleChunks();
+    std::vector<int> order(chunks.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        order[k] = k;
+    }
+    auto noise = [&chunks]() {
+        Terrain T(kSeed);
+        std::vector<std::vector<float>> res;
+        for (const glm::ivec2& c : chunks) {
+            res.push_back(T.getChunk(c).genPerlinNoise());
+        }
+        return res;
+    };
+    NoiseKernel original = getNoiseKernel();
+    setNoiseKernel(NoiseKernel::kScalar);
+    std::vector<std::vector<float>> referenceNoise = noise();
+    std::vector<ChunkData> reference = generateInOrder(order);
+    bool ok = true;
+    for (NoiseKernel kernel : {NoiseKernel::kSSE, NoiseKernel::kAVX2}) {
+        if (!setNoiseKernel(kernel)) {
+            continue;
+        }
+        std::vector<std::vector<float>> runNoise = noise();
+        std::vector<ChunkData> run = generateInOrder(order);
+        for (size_t k = 0; k < reference.size(); k++) {
+            ok = ok && sameBytes(runNoise[k], referenceNoise[k]) &&
+                 sameChunk(run[k], reference[k]);
+        }
+    }
+    setNoiseKernel(original);
+    return ok;
+}
+
+// Tiles are cut from one world-aligned field: a chunk's tile is the matching
+// quarter of the tile of a chunk twice the extent at twice the frequency,
+// for positive and negative chunk coordinates alike. Also, every kernel
+// returns the scalar one's bits on octaves drawn with spans and with rows.
+bool checkFractalTiles()
+{
+    FractalNoise<8> fine(7, 0.25f, 2.0f, 0.5f);
+    std::vector<float> reference(32 * 32), tile(32 * 32);
+    NoiseKernel original = getNoiseKernel();
+    setNoiseKernel(NoiseKernel::kScalar);
+    fine.tile(glm::ivec2(-3, 5), 32, reference.data());
+    bool ok = true;
+    for (NoiseKernel k : {NoiseKernel::kSSE, NoiseKernel::kAVX2}) {
+        if (!setNoiseKernel(k)) {
+            continue;
+        }
+        fine.tile(glm::ivec2(-3, 5), 32, tile.data());
+        ok = ok && sameBytes(tile, reference);
+    }
+    setNoiseKernel(original);
+    if (!ok) {
+        return false;
+    }
+
+    const int n = 16;
+    FractalNoise<3> small(7, 1.5f, 2.0f, 0.5f);
+    FractalNoise<3> large(7, 3.0f, 2.0f, 0.5f);
+    std::vector<float> a(n * n), b(4 * n * n);
+    for (glm::ivec2 c : {glm::ivec2(1, 0), glm::ivec2(-1, -1),
+                         glm::ivec2(3, -2)}) {
+        small.tile(c, n, a.data());
+        glm::ivec2 big(c.x >= 0 ? c.x / 2 : (c.x - 1) / 2,
+                       c.y >= 0 ? c.y / 2 : (c.y - 1) / 2);
+        large.tile(big, 2 * n, b.data());
+        glm::ivec2 corner = c * n - big * (2 * n);
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                int k = corner.x + i + 2 * n * (corner.y + j);
+                // Positions on the two lattices may round apart
+                if (fabs(a[i + n * j] - b[k]) > 1e-5f) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Row edges: on a 3x3 map, a tall cell at the end of a row must not be
+// compared with the start of the next row, and cell 0 is a neighbor like
+// any other
+bool checkSeams()
+{
+    // Heights, row by row; only the center column's neighbors differ
+    const float h[9] = {0, 0, 5,
+                        0, 0, 0,
+                        0, 0, 0};
+    std::vector<glm::vec3> map;
+    for (int i = 0; i < 9; i++) {
+        map.emplace_back(i % 3, h[i], i / 3);
+    }
+    std::vector<glm::vec3> filled = map;
+    fixNeighborGaps(filled, 3);
+    // Cell 2 drops to 0 on both of its neighbors: 4 fillers, all at (2, z=0)
+    bool ok = filled.size() == 9 + 4;
+    for (size_t i = 9; i < filled.size(); i++) {
+        ok = ok && filled[i].x == 2 && filled[i].z == 0;
+    }
+
+    // Cell 0 is higher than cell 1 and 3, and must get fillers
+    map[2].y = 0;
+    map[0].y = 3;
+    filled = map;
+    fixNeighborGaps(filled, 3);
+    ok = ok && filled.size() == 9 + 2;
+
+    // Only the wrapped neighbor of cell 2 (cell 3) is lower: cell 2 still
+    // drops to 0 for 4 fillers, and cell 3, lower than all of its real
+    // neighbors, gets none
+    map[0].y = 0;
+    map[2].y = 5;
+    map[3].y = -5;
+    filled = map;
+    fixNeighborGaps(filled, 3);
+    int atCell2 = 0, atCell3 = 0;
+    for (size_t i = 9; i < filled.size(); i++) {
+        atCell2 += filled[i].x == 2 && filled[i].z == 0;
+        atCell3 += filled[i].x == 0 && filled[i].z == 1;
+    }
+    return ok && atCell2 == 4 && atCell3 == 0;
+}
+
+// Saved chunks load back as they were saved, the header reaches the file
+// with its padding zeroed, and a record moved off the four-byte grid is
+// rejected rather than read
+bool checkRegionFiles()
+{
+    char dir[] = "/tmp/terrain_tests.XXXXXX";
+    if (!mkdtemp(dir)) {
+        return false;
+    }
+    Terrain T(kSeed);
+    std::vector<ChunkColumns> saved;
+    for (int i = 0; i < 3; i++) {
+        saved.push_back(T.getChunkColumns(glm::ivec2(i, 1), kHeights));
+    }
+    RegionStore store(dir, kSeed, T.getChunkExtent(), kHeights);
+    bool ok = store.save(saved);
+    for (const ChunkColumns& c : saved) {
+        ChunkColumns loaded;
+        ok = ok && store.load(c.coords(), loaded) &&
+             loaded.origin == c.origin && loaded.texSeed == c.texSeed &&
+             sameBytes(loaded.top, c.top) && sameBytes(loaded.depth, c.depth);
+    }
+
+    std::string path = store.regionPath(glm::ivec2(0, 0));
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    size_t fields = offsetof(RegionHeader, regionZ) + sizeof(int32_t);
+    ok = ok && bytes.size() > sizeof(RegionHeader);
+    for (size_t i = fields; ok && i < sizeof(RegionHeader); i++) {
+        ok = bytes[i] == 0;
+    }
+
+    // Chunk (1, 1) is entry 1 + 32 of the offset table
+    std::string moved = std::string(dir) + "/moved.region";
+    if (ok) {
+        size_t entry = sizeof(RegionHeader) + sizeof(uint32_t) * 33;
+        uint32_t offset;
+        memcpy(&offset, &bytes[entry], sizeof(offset));
+        offset += 2;
+        memcpy(&bytes[entry], &offset, sizeof(offset));
+        std::ofstream out(moved, std::ios::binary);
+        out.write(bytes.data(), bytes.size());
+    }
+    {
+        RegionFile f(moved);
+        ChunkColumns c;
+        ok = ok && f.isOpen() && f.contains(glm::ivec2(0, 1)) &&
+             !f.contains(glm::ivec2(1, 1)) && !f.read(glm::ivec2(1, 1), c);
+    }
+
+    unlink(moved.c_str());
+    unlink(path.c_str());
+    rmdir(dir);
+    return ok;
+}
+
+// Face counts the mesher must produce for volumes small enough to count by
+// hand
+bool checkMesher()
+{
+    std::vector<float> seeds(16, 0.5f);
+    bool ok = true;
+
+    // A lone block: six unit quads
+    ChunkVolume block(glm::ivec3(0), glm::ivec3(3, 1, 3));
+    block.set(glm::ivec3(1, 0, 1), kSnow);
+    ChunkMesh m = greedyMesh(block, seeds);
+    ok = ok && m.faces.size() == 12 && m.exposedFaces == 6;
+
+    // A flat 4x4 slab: still six quads, 2*16 + 4*4 unit faces
+    ChunkVolume slab(glm::ivec3(0), glm::ivec3(6, 1, 6));
+    for (int z = 1; z <= 4; z++) {
+        for (int x = 1; x <= 4; x++) {
+            slab.set(glm::ivec3(x, 0, z), kGrass);
+        }
+    }
+    m = greedyMesh(slab, seeds);
+    ok = ok && m.faces.size() == 12 && m.exposedFaces == 48;
+
+    // The same slab with apron blocks all around: the sides are hidden
+    for (int k = 0; k < 6; k++) {
+        for (glm::ivec3 p : {glm::ivec3(k, 0, 0), glm::ivec3(k, 0, 5),
+                             glm::ivec3(0, 0, k), glm::ivec3(5, 0, k)}) {
+            slab.set(p, kGrass);
+        }
+    }
+    m = greedyMesh(slab, seeds);
+    ok = ok && m.faces.size() == 4 && m.exposedFaces == 32;
+
+    // Two materials side by side do not merge: two quads on top, bottom
+    // and the two long sides, one on each end
+    ChunkVolume split(glm::ivec3(0), glm::ivec3(4, 1, 3));
+    split.set(glm::ivec3(1, 0, 1), kGrass);
+    split.set(glm::ivec3(2, 0, 1), kSnow);
+    m = greedyMesh(split, seeds);
+    ok = ok && m.faces.size() == 2 * 10 && m.exposedFaces == 10;
+    return ok;
+}
+
+// True if p is inside the clip volume of viewProjection
+bool inClipVolume(const glm::mat4& viewProjection, glm::vec3 p)
+{
+    glm::vec4 c = viewProjection * glm::vec4(p, 1.0f);
+    return fabs(c.x) <= c.w && fabs(c.y) <= c.w && fabs(c.z) <= c.w;
+}
+
+bool checkFrustum()
+{
+    // Looking down -z from the origin, 90 degrees, near 1, far 100
+    glm::mat4 vp = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+    Frustum f(vp);
+    auto box = [](glm::vec3 lo, glm::vec3 hi) { return Aabb{lo, hi}; };
+    bool ok = f.intersects(box(glm::vec3(-1, -1, -11), glm::vec3(1, 1, -9)));
+    ok = ok && !f.intersects(box(glm::vec3(-1, -1, 9), glm::vec3(1, 1, 11)));
+    ok = ok && !f.intersects(box(glm::vec3(-1, -1, -120),
+                                 glm::vec3(1, 1, -110)));
+    ok = ok && !f.intersects(box(glm::vec3(-30, -1, -11),
+                                 glm::vec3(-20, 1, -9)));
+    // Straddling the left plane (x = z)
+    ok = ok && f.intersects(box(glm::vec3(-12, -1, -11), glm::vec3(-8, 1, -9)));
+
+    // Random boxes under a rotated view: any box with a sampled point inside
+    // the clip volume must pass
+    glm::mat4 rotated = vp * glm::lookAt(glm::vec3(3, 5, 2),
+                                         glm::vec3(40, -3, 25),
+                                         glm::vec3(0, 1, 0));
+    Frustum g(rotated);
+    srand(7);
+    auto coord = []() { return (float)(rand() % 2001 - 1000) / 10.0f; };
+    for (int i = 0; ok && i < 20000; i++) {
+        glm::vec3 lo(coord(), coord(), coord());
+        glm::vec3 size(rand() % 32 + 1, rand() % 32 + 1, rand() % 32 + 1);
+        bool pointInside = false;
+        for (int k = 0; k < 27 && !pointInside; k++) {
+            glm::vec3 t(k % 3 / 2.0f, k / 3 % 3 / 2.0f, k / 9 / 2.0f);
+            pointInside = inClipVolume(rotated, lo + t * size);
+        }
+        ok = !pointInside || g.intersects(box(lo, lo + size));
+    }
+    return ok;
+}
+
+bool checkLodLevels()
+{
+    auto same = [](const std::vector<LodLevel>& a,
+                   std::vector<LodLevel> b) {
+        bool ok = a.size() == b.size();
+        for (size_t k = 0; ok && k < a.size(); k++) {
+            ok = a[k].step == b[k].step && a[k].radius == b[k].radius;
+        }
+        return ok;
+    };
+    return same(lodLevels(2, 32, 32), {{1, 2}, {2, 4}, {4, 8}, {8, 32}}) &&
+           same(lodLevels(2, 5, 32), {{1, 2}, {2, 4}, {4, 5}}) &&
+           same(lodLevels(3, 3, 32), {{1, 3}}) &&
+           same(lodLevels(2, 32, 33), {{1, 2}}) &&
+           same(lodLevels(2, 32, 4), {{1, 2}, {2, 32}});
+}
+
+// Over every column of the chunk, the highest upward face of its LOD mesh
+// must be the top of the tallest column in the column's cell, and the mesh
+// must reach down to the lowest render height
+bool checkLodMesh(Terrain& T, glm::ivec2 c, int step)
+{
+    int n = T.getChunkExtent();
+    std::vector<glm::vec3> surface = T.chunkSurface(c, kHeights);
+    ChunkMesh mesh = T.getLodMesh(c, kHeights, step);
+    if (mesh.bounds().min.y > floor(kHeights.x)) {
+        return false;
+    }
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            float cellTop = -1e9f;
+            for (int dj = 0; dj < step; dj++) {
+                for (int di = 0; di < step; di++) {
+                    int k = i / step * step + di + n * (j / step * step + dj);
+                    cellTop = std::max(cellTop, floorf(surface[k].y) + 1.0f);
+                }
+            }
+            glm::vec2 p(c.x * n + i + 0.5f, c.y * n + j + 0.5f);
+            float highest = -1e9f;
+            for (const glm::uvec3& f : mesh.faces) {
+                glm::vec3 a(mesh.vertices[f.x]), b(mesh.vertices[f.y]),
+                        d(mesh.vertices[f.z]);
+                if (glm::cross(b - a, d - a).y <= 0.0f) {
+                    continue; // Not facing up
+                }
+                glm::vec2 lo = glm::min(glm::vec2(a.x, a.z),
+                                        glm::min(glm::vec2(b.x, b.z),
+                                                 glm::vec2(d.x, d.z)));
+                glm::vec2 hi = glm::max(glm::vec2(a.x, a.z),
+                                        glm::max(glm::vec2(b.x, b.z),
+                                                 glm::vec2(d.x, d.z)));
+                // Mesh triangles are halves of axis-aligned quads, so their
+                // bounding boxes overlap only for the two halves of a quad
+                if (p.x > lo.x && p.x < hi.x && p.y > lo.y && p.y < hi.y) {
+                    highest = std::max(highest, a.y);
+                }
+            }
+            if (highest != cellTop) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The levels out from the default view, and the chunks on either side of
+// each level's inner edge
+bool checkLod()
+{
+    if (!checkLodLevels()) {
+        return false;
+    }
+    Terrain T(kSeed);
+    std::vector<LodLevel> levels = lodLevels(Terrain::kDefaultViewRadius,
+                                             32, T.getChunkExtent());
+    for (size_t k = 1; k < levels.size(); k++) {
+        int inner = levels[k - 1].radius;
+        for (int i = -inner - 1; i <= inner + 1; i++) {
+            if (!checkLodMesh(T, glm::ivec2(i, inner + 1), levels[k].step)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Random sets on a section stack against a dense array, through every
+// index width and back to uniform sections
+bool checkBlockSections()
+{
+    const int extent = 20, height = 40; // Edges not on section boundaries
+    const glm::ivec2 c(-1, 2);
+    ChunkBlocks blocks(c, extent, 0, 0);
+    std::vector<uint8_t> dense(extent * extent * height, kAir);
+    glm::ivec3 origin(c.x * extent, -8, c.y * extent);
+    auto same = [&]() {
+        for (int y = -2; y < height + 2; y++) {
+            for (int z = -1; z <= extent; z++) {
+                for (int x = -1; x <= extent; x++) {
+                    bool inside = x >= 0 && z >= 0 && y >= 0 &&
+                                  x < extent && z < extent && y < height;
+                    uint8_t want =
+                            inside ? dense[x + extent * (z + extent * y)]
+                                   : kAir;
+                    if (blocks.get(origin + glm::ivec3(x, y, z)) != want) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    };
+    uint32_t state = 12345;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    // Types 0..3, then 0..15, then 0..199: 2, 4 and 8 bit indices
+    for (int types : {4, 16, 200}) {
+        for (int n = 0; n < 20000; n++) {
+            glm::ivec3 l(next() % extent, next() % height, next() % extent);
+            uint8_t b = next() % types;
+            if (!blocks.set(origin + l, b)) {
+                return false;
+            }
+            dense[l.x + extent * (l.z + extent * l.y)] = b;
+        }
+        if (!same()) {
+            return false;
+        }
+    }
+    blocks.compact();
+    if (!same() || blocks.set(origin + glm::ivec3(extent, 0, 0), kSnow)) {
+        return false;
+    }
+    // Clearing every block leaves only uniform air sections
+    for (int y = 0; y < height; y++) {
+        for (int z = 0; z < extent; z++) {
+            for (int x = 0; x < extent; x++) {
+                blocks.set(origin + glm::ivec3(x, y, z), kAir);
+            }
+        }
+    }
+    blocks.compact();
+    std::fill(dense.begin(), dense.end(), kAir);
+    return same() && blocks.uniformSections() == blocks.sectionCount();
+}
+
+// blocksFromColumns() must agree block for block, types included, with the
+// volume the mesher builds from the same chunk
+bool checkChunkBlocks(Terrain& T, glm::ivec2 c)
+{
+    ChunkBlocks blocks = blocksFromColumns(T.getChunkColumns(c, kHeights));
+    ChunkVolume volume = T.getChunkVolume(c, kHeights);
+    glm::ivec3 o = volume.getOrigin(), size = volume.getSize();
+    for (int y = -1; y <= size.y; y++) {
+        for (int z = 1; z + 1 < size.z; z++) {
+            for (int x = 1; x + 1 < size.x; x++) {
+                glm::ivec3 l(x, y, z);
+                if (blocks.get(o + l) != volume.get(l)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool checkBlocksFromColumns()
+{
+    Terrain T(kSeed);
+    return checkChunkBlocks(T, glm::ivec2(0, 0)) &&
+           checkChunkBlocks(T, glm::ivec2(-3, 5));
+}
+
+bool sameMesh(const ChunkMesh& a, const ChunkMesh& b)
+{
+    if (a.vertices.size() != b.vertices.size() ||
+        a.faces.size() != b.faces.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.vertices.size(); i++) {
+        if (a.vertices[i] != b.vertices[i]) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.faces.size(); i++) {
+        if (a.faces[i] != b.faces[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Unit faces a block at p would add if placed: one per air neighbor, less
+// the face of each solid neighbor it covers
+int facesAdded(const ChunkRing& ring, const glm::ivec3& p)
+{
+    const glm::ivec3 dirs[6] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                                {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+    int added = 0;
+    for (const glm::ivec3& d : dirs) {
+        added += ring.blockAt(p + d) == kAir ? 1 : -1;
+    }
+    return added;
+}
+
+bool checkEdits()
+{
+    Terrain T(kSeed);
+    ChunkRing ring(Terrain::kDefaultViewRadius);
+    fillRing(T, ring);
+    int n = T.getChunkExtent();
+    int center = ring.slotIndex(glm::ivec2(0, 0));
+    // Unedited, the remesh is the mesh generated for the chunk
+    if (!sameMesh(ring.remesh(center),
+                  T.getChunkMesh(glm::ivec2(0, 0), kHeights))) {
+        return false;
+    }
+    std::vector<glm::vec4> instances =
+            ring.reinstance(center, Terrain::kFillerSeed);
+    if (instances.size() != ring.getSlot(center).columns.blockCount()) {
+        return false;
+    }
+
+    // Breaking then restoring the surface block of column (i, j)
+    glm::ivec3 origin = ring.getSlot(center).blockTypes.getOrigin();
+    auto surface = [&](int i, int j) {
+        glm::ivec3 p = origin + glm::ivec3(i, 0, j);
+        p.y = ring.getSlot(center).columns.top[i + n * j];
+        return p;
+    };
+    size_t before = ring.remesh(center).exposedFaces;
+    glm::ivec3 p = surface(n / 2, n / 2);
+    uint8_t type = ring.blockAt(p);
+    int removed = facesAdded(ring, p);
+    if (!ring.setBlock(p, kAir) || ring.setBlock(p, kAir)) {
+        return false;
+    }
+    std::vector<int> dirty = ring.takeDirty();
+    if (dirty != std::vector<int>{center} ||
+        ring.remesh(center).exposedFaces != before - removed) {
+        return false;
+    }
+    ring.setBlock(p, type);
+    ring.takeDirty();
+    if (ring.remesh(center).exposedFaces != before) {
+        return false;
+    }
+
+    // An edit on the chunk's -x edge dirties the neighbor too, and one on
+    // its (+x, +z) corner both neighbors across those edges
+    ring.setBlock(surface(0, n / 2) + glm::ivec3(0, 1, 0), type);
+    dirty = ring.takeDirty();
+    if (dirty != std::vector<int>{center,
+                                  ring.slotIndex(glm::ivec2(-1, 0))}) {
+        return false;
+    }
+    ring.setBlock(surface(n - 1, n - 1) + glm::ivec3(0, 1, 0), type);
+    dirty = ring.takeDirty();
+    std::sort(dirty.begin(), dirty.end());
+    std::vector<int> want = {center, ring.slotIndex(glm::ivec2(1, 0)),
+                             ring.slotIndex(glm::ivec2(0, 1))};
+    std::sort(want.begin(), want.end());
+    if (dirty != want) {
+        return false;
+    }
+    // The edited neighbor's apron now holds the new block
+    int east = ring.slotIndex(glm::ivec2(1, 0));
+    ChunkVolume volume = ring.volumeOf(east);
+    glm::ivec3 q = surface(n - 1, n - 1) + glm::ivec3(0, 1, 0);
+    return volume.get(q - volume.getOrigin()) == type;
+}
+
+bool checkTimestep()
+{
+    FixedTimestep clock(kTickRate, 4);
+    double tick = clock.getTickSeconds();
+    // 2.5 ticks: two now, half a tick left over
+    if (clock.advance(2.5 * tick) != 2 || fabs(clock.alpha() - 0.5f) > 1e-4 ||
+        fabs(clock.lateness(0, 2) - 1.5 * tick) > 1e-9) {
+        return false;
+    }
+    // A stall runs at most four and drops the rest
+    if (clock.advance(10.0 * tick) != 4 || clock.droppedTicks() != 6 ||
+        clock.tickCount() != 6 || clock.alpha() < 0.0f ||
+        clock.alpha() >= 1.0f) {
+        return false;
+    }
+    // Interpolating all the way lands on the eye after the tick
+    Camera camera;
+    camera.begin_tick();
+    camera.mm_trans_cam(1.0, 0.0);
+    glm::mat4 a = camera.get_view_matrix(1.0f);
+    glm::mat4 b = camera.get_view_matrix();
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            if (fabs(a[i][j] - b[i][j]) > 1e-5f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The camera's box (camera.cc), as an entity
+const glm::vec3 kCameraSize(0.98f, 1.75f, 0.98f);
+
+bool checkEntities()
+{
+    Terrain T(kSeed);
+    ChunkRing ring(Terrain::kDefaultViewRadius);
+    fillRing(T, ring);
+
+    // An entity with the camera's box falls and walks as the camera does
+    CollisionGrid grid;
+    grid.build(ring.offsetsNear(glm::ivec2(0, 0), 1));
+    Chunk chunk = T.getChunk(glm::ivec2(0, 0));
+    Camera camera;
+    EntitySystem one;
+    glm::vec3 feet(0.0f, kCameraSize.y, 0.0f);
+    one.spawn(camera.getEye() - feet, kCameraSize);
+    double tick = 1.0 / kTickRate;
+    for (int t = 0; t < 6 * kTickRate; t++) {
+        camera.update_physics(tick, chunk, grid);
+        camera.ws_walk_cam(1, grid);
+        one.tick(tick, ring);
+        one.setVelocity(0, one.getVelocity(0) + camera.getLook());
+        if (glm::length(one.getPosition(0) + feet - camera.getEye()) >
+            1e-3f) {
+            return false;
+        }
+    }
+
+    // One thread or four, and however the work splits, the same result
+    int n = EntitySystem::kMaxBatch * 3;
+    EntitySystem serial(1), parallel(4);
+    spawnEntities(serial, ring, T.getChunkExtent(), n, 7);
+    spawnEntities(parallel, ring, T.getChunkExtent(), n, 7);
+    // And one over a chunk that is not loaded, which sleeps
+    glm::vec3 far(100.0f * T.getChunkExtent(), 5.0f, 0.0f);
+    serial.spawn(far, kCameraSize);
+    for (int t = 0; t < 4 * kTickRate; t++) {
+        serial.tick(tick, ring);
+        parallel.tick(tick, ring);
+    }
+    if (serial.awakeCount() != parallel.awakeCount() ||
+        serial.size() != n + 1) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        if (serial.getId(i) != parallel.getId(i) ||
+            serial.getPosition(i) != parallel.getPosition(i) ||
+            serial.getVelocity(i) != parallel.getVelocity(i)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < serial.size(); i++) {
+        uint32_t id = serial.getId(i);
+        Aabb box = serial.bounds(i);
+        float width = (int)id == n ? kCameraSize.x
+                      : id % 4 == 0 ? 0.6f
+                                    : 0.25f + 0.05f * (id % 3);
+        // Sorting kept each entity's fields together, and after 4 s every
+        // one has landed, the sleeper where it was put
+        if (fabs(box.max.x - box.min.x - width) > 1e-3f ||
+            serial.getVelocity(i).y != 0.0f ||
+            ((int)id == n && serial.getPosition(i) != far)) {
+            return false;
+        }
+    }
+    // Removing moves the last entity into the hole
+    uint32_t last = serial.getId(serial.size() - 1);
+    serial.remove(0);
+    return serial.size() == n && serial.getId(0) == last;
+}
+
+// Frames of 1..100 ms with every tenth marked have nearest-rank
+// percentiles of exactly 50, 95 and 99 ms, and 50 ms over the marked ones
+bool checkPercentiles()
+{
+    Profiler p;
+    p.enable(false);
+    for (int i = 1; i <= 100; i++) {
+        p.beginFrame();
+        p.record(kZoneDraw, tic(), i * 1e-3);
+        // GPU times arrive a frame late, and every other frame goes untimed
+        if (i % 2 == 0) {
+            p.recordGpu(kZoneGpuDraw, p.frameIndex() - 1, tic(), 2e-3);
+        }
+        p.endFrame(i % 10 == 0);
+    }
+    ZoneStats all = p.stats(kZoneDraw, false);
+    ZoneStats marked = p.stats(kZoneDraw, true);
+    ZoneStats gpu = p.stats(kZoneGpuDraw, false);
+    // Frame times are kept as floats
+    auto near = [](double a, double b) { return fabs(a - b) < 1e-6; };
+    return all.frames == 100 && near(all.p50, 0.050) &&
+           near(all.p95, 0.095) && near(all.p99, 0.099) &&
+           near(all.max, 0.100) && marked.frames == 10 &&
+           near(marked.p50, 0.050) && gpu.frames == 50 &&
+           near(gpu.p50, 0.002) && near(gpu.mean, 0.002);
+}
+
+struct Test {
+    const char* name;
+    bool (*run)();
+};
+
+const Test kTests[] = {
+        {"determinism", checkDeterminism},
+        {"noise_kernels", checkNoiseKernels},
+        {"fractal_tiles", checkFractalTiles},
+        {"seams", checkSeams},
+        {"region_files", checkRegionFiles},
+        {"mesher", checkMesher},
+        {"frustum", checkFrustum},
+        {"lod", checkLod},
+        {"block_sections", checkBlockSections},
+        {"chunk_blocks", checkBlocksFromColumns},
+        {"edits", checkEdits},
+        {"timestep", checkTimestep},
+        {"entities", checkEntities},
+        {"percentiles", checkPercentiles},
+};
+
+bool selected(const char* name, int argc, char* argv[])
+{
+    if (argc < 2) {
+        return true;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        bool known = false;
+        for (const Test& t : kTests) {
+            known = known || strcmp(argv[i], t.name) == 0;
+        }
+        if (!known) {
+            fprintf(stderr, "%s: no test named %s\n", argv[0], argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    int failed = 0;
+    for (const Test& t : kTests) {
+        if (!selected(t.name, argc, argv)) {
+            continue;
+        }
+        bool ok = t.run();
+        printf("%-16s %s\n", t.name, ok ? "ok" : "FAILED");
+        failed += !ok;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
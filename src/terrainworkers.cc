@@ -0,0 +1,142 @@
+#include "terrainworkers.h"
+#include <algorithm>
+#include "profiler.h"
+
+TerrainWorkers::TerrainWorkers(Terrain& T, glm::vec2 heights, int nThreads,
+                               bool meshChunks)
+    : terrain(T), heights(heights), meshChunks(meshChunks), finished(64)
+{
+    for (int i = 0; i < std::max(nThreads, 1); i++) {
+        threads.emplace_back(&TerrainWorkers::run, this);
+    }
+}
+
+TerrainWorkers::~TerrainWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobReady.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+int TerrainWorkers::defaultThreadCount()
+{
+    int hw = (int)std::thread::hardware_concurrency();
+    return std::max(hw - 1, 1);
+}
+
+void TerrainWorkers::prefetch(glm::ivec2 center, int radius)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        // Stale predictions are no longer worth computing
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                                  [](const Job& j) {
+                                      return j.kind == Job::kSurface;
+                                  }),
+                   jobs.end());
+
+        for (int i = -radius; i <= radius; i++) {
+            for (int j = -radius; j <= radius; j++) {
+                glm::ivec2 c = center + glm::ivec2(i, j);
+                if (!terrain.hasSurface(c)) {
+                    jobs.push_back(Job{Job::kSurface, c, 1});
+                }
+            }
+        }
+    }
+    jobReady.notify_all();
+}
+
+void TerrainWorkers::requestChunks(const std::vector<glm::ivec2>& chunks)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                                  [](const Job& j) {
+                                      return j.kind == Job::kChunk;
+                                  }),
+                   jobs.end());
+        for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+            jobs.push_front(Job{Job::kChunk, *it, 1});
+        }
+    }
+    jobReady.notify_all();
+}
+
+void TerrainWorkers::requestLodChunks(const std::vector<glm::ivec2>& chunks,
+                                      int step)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                                  [step](const Job& j) {
+                                      return j.kind == Job::kLod &&
+                                             j.lodStep == step;
+                                  }),
+                   jobs.end());
+        for (const glm::ivec2& c : chunks) {
+            jobs.push_back(Job{Job::kLod, c, step});
+        }
+    }
+    jobReady.notify_all();
+}
+
+bool TerrainWorkers::pollChunk(ChunkData& chunk)
+{
+    return finished.pop(chunk);
+}
+
+void TerrainWorkers::run()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobReady.wait(lock,
+                          [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        if (job.kind == Job::kSurface) {
+            ScopedTimer timer(kZoneTerrain);
+            terrain.prefetchSurface(job.coords);
+            continue;
+        }
+
+        ChunkData chunk;
+        {
+            ScopedTimer timer(kZoneTerrain);
+            chunk.coords = job.coords;
+            if (job.kind == Job::kLod) {
+                chunk.lodStep = job.lodStep;
+                chunk.mesh = terrain.getLodMesh(job.coords, heights,
+                                                job.lodStep);
+            } else {
+                chunk.columns = terrain.getChunkColumns(job.coords, heights);
+                chunk.blocks = blocksFromColumns(chunk.columns);
+                if (meshChunks) {
+                    chunk.mesh = terrain.getChunkMesh(job.coords, heights);
+                }
+            }
+        }
+
+        // The render thread drains this every frame, so a full queue only
+        // lasts until its next poll.
+        while (!finished.push(chunk)) {
+            if (stopping) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
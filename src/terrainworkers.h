@@ -0,0 +1,69 @@
+#ifndef TERRAINWORKERS_H
+#define TERRAINWORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "Terrain.h"
+#include "mpmcqueue.h"
+
+/* A pool of threads that generates terrain off the render thread.
+
+   Three kinds of jobs are accepted from the render thread:
+     - prefetch(): generate and cache the blended surfaces of every chunk
+       within a radius of a (predicted) chunk, so they are ready before the
+       player arrives.
+     - requestChunks(): build the columns (surface plus seam fillers) of
+       chunks that just came into view, and their greedy meshes if the pool
+       was created with meshChunks. These jobs jump ahead of queued
+       prefetches.
+     - requestLodChunks(): build the downsampled meshes of distant chunks
+       for one level of detail, after everything else that is queued.
+
+   Finished chunks are published through a lock-free queue; pollChunk()
+   never blocks, so the render thread keeps drawing what it has until the
+   new chunks are available. */
+class TerrainWorkers {
+    struct Job {
+        enum Kind { kSurface, kChunk, kLod } kind;
+        glm::ivec2 coords;
+        int lodStep;
+    };
+
+    Terrain& terrain;
+    glm::vec2 heights;
+    bool meshChunks;
+
+    std::vector<std::thread> threads;
+    std::mutex jobMutex;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    std::atomic<bool> stopping{false};
+
+    MpmcQueue<ChunkData> finished;
+
+    void run();
+
+    public:
+    TerrainWorkers(Terrain& T, glm::vec2 heights, int nThreads,
+                   bool meshChunks = false);
+    ~TerrainWorkers();
+
+    // Replaces any still-queued prefetches with the chunks around center
+    void prefetch(glm::ivec2 center, int radius);
+    // Replaces any still-queued chunk requests; the first chunk is built first
+    void requestChunks(const std::vector<glm::ivec2>& chunks);
+    // Replaces any still-queued requests for the same step
+    void requestLodChunks(const std::vector<glm::ivec2>& chunks, int step);
+    bool pollChunk(ChunkData& chunk);
+
+    // Reasonable default: leave one core for the render thread
+    static int defaultThreadCount();
+};
+
+#endif
@@ -78,7 +78,12 @@ void ReportLastWindowsError(void)
 }
 #endif
 
-TicTocTimer g_last;
+// Per thread, since tic() is called from the profiler on worker threads
+#ifdef _MSC_VER
+__declspec(thread) TicTocTimer g_last;
+#else
+__thread TicTocTimer g_last;
+#endif
 
 TicTocTimer tic(void)
 { TicTocTimer t = {0,0};